@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    BandGate.cpp
+    Per-band activity detection that lets idle band networks be skipped.
+
+  ==============================================================================
+*/
+
+#include "BandGate.h"
+
+//==============================================================================
+void BandGate::prepare (int numStreams)
+{
+    streams.assign ((size_t) numStreams, {});
+}
+
+void BandGate::reset() noexcept
+{
+    for (auto& stream : streams)
+        stream = {};
+}
+
+BandGate::Action BandGate::update (int stream, const float* input, int numSamples) noexcept
+{
+    auto& state = streams[(size_t) stream];
+
+    const auto range = juce::FloatVectorOperations::findMinAndMax (input, numSamples);
+    const float peak = juce::jmax (-range.getStart(), range.getEnd());
+
+    if (peak > threshold)
+    {
+        state.quietSamples = 0;
+        state.action = state.open ? Action::process : Action::fadeIn;
+        state.open = true;
+    }
+    else
+    {
+        state.quietSamples = (int) juce::jmin ((juce::int64) state.quietSamples + numSamples,
+                                               (juce::int64) std::numeric_limits<int>::max());
+
+        if (state.open && state.quietSamples > holdSamples)
+        {
+            state.open = false;
+            state.action = Action::fadeOut;
+        }
+        else
+        {
+            state.action = state.open ? Action::process : Action::skip;
+        }
+    }
+
+    return state.action;
+}
+
+void BandGate::applyAction (Action action, float* data, int numSamples) const noexcept
+{
+    if (action == Action::process)
+        return;
+
+    if (action == Action::skip)
+    {
+        juce::FloatVectorOperations::clear (data, numSamples);
+        return;
+    }
+
+    // Linear ramp over the start of the chunk; a closing stream is silent after it
+    const int fadeLength = juce::jmin (fadeSamples, numSamples);
+    const float step = 1.0f / (float) fadeLength;
+    const bool fadeIn = action == Action::fadeIn;
+
+    for (int i = 0; i < fadeLength; ++i)
+        data[i] *= fadeIn ? (float) (i + 1) * step : (float) (fadeLength - 1 - i) * step;
+
+    if (! fadeIn)
+        juce::FloatVectorOperations::clear (data + fadeLength, numSamples - fadeLength);
+}
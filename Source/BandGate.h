@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    BandGate.h
+    Per-band activity detection that lets idle band networks be skipped.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Tracks the envelope of every (channel, band) stream after the band split and
+    decides, chunk by chunk, whether its network has to run.
+
+    A stream closes once its peak level has stayed below thresholdDecibels for
+    longer than the hold time, i.e. the receptive field of the network at the
+    processing rate: by then the network only sees silence and its output is
+    the idle response. Closed streams skip inference and output silence. The
+    chunk that closes a stream fades it out, and the chunk that reopens it fades
+    it back in, after the caller has settled the engine (TCNEngine::settle()),
+    both over the short fade time so that transients keep their attack.
+
+    Everything runs on the audio thread; allocation happens in prepare() only.
+*/
+class BandGate
+{
+public:
+    static constexpr float thresholdDecibels = -80.0f;
+
+    enum class Action
+    {
+        process,    // open: run the network
+        fadeIn,     // just reopened: settle, run, then fade the output in
+        fadeOut,    // just closed: run, then fade the output out
+        skip        // closed: output silence
+    };
+
+    BandGate() = default;
+
+    void prepare (int numStreams);
+
+    /** Opens every stream, e.g. after the engines were reset. */
+    void reset() noexcept;
+
+    /** Time a stream must stay quiet before it closes, in samples at the processing rate. */
+    void setHoldTime (int numSamples) noexcept          { holdSamples = juce::jmax (0, numSamples); }
+
+    /** Length of the fades on opening and closing, in samples at the processing rate. */
+    void setFadeTime (int numSamples) noexcept          { fadeSamples = juce::jmax (1, numSamples); }
+
+    /** Feeds the next chunk of a stream's input to its envelope and returns what to do with it. */
+    Action update (int stream, const float* input, int numSamples) noexcept;
+
+    /** The action last returned by update() for a stream. */
+    Action getAction (int stream) const noexcept        { return streams[(size_t) stream].action; }
+
+    /** Applies the fade of a fadeIn or fadeOut action to a processed chunk, or clears a skipped one. */
+    void applyAction (Action action, float* data, int numSamples) const noexcept;
+
+private:
+    struct Stream
+    {
+        bool open = true;
+        int quietSamples = 0;
+        Action action = Action::process;
+    };
+
+    std::vector<Stream> streams;
+    int holdSamples = 0, fadeSamples = 64;
+    const float threshold = juce::Decibels::decibelsToGain (thresholdDecibels);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandGate)
+};
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    CabinetStage.cpp
+    Optional impulse-response (cabinet) convolution after the band sum.
+
+  ==============================================================================
+*/
+
+#include "CabinetStage.h"
+
+//==============================================================================
+CabinetStage::CabinetStage() = default;
+
+// The convolutions hand their last jobs to the queue: they go first
+CabinetStage::~CabinetStage()
+{
+    convolutions.clear();
+}
+
+void CabinetStage::prepare (double sampleRate, int numChannels, int maximumBlockSize)
+{
+    const juce::ScopedLock sl (fileLock);
+
+    convolutions.clear();
+
+    for (int ch = 0; ch < numChannels; ch += 2)
+    {
+        auto convolution = std::make_unique<juce::dsp::Convolution> (juce::dsp::Convolution::NonUniform { headSize }, loadQueue);
+        convolution->prepare ({ sampleRate, (juce::uint32) maximumBlockSize, (juce::uint32) juce::jmin (2, numChannels - ch) });
+        convolutions.push_back (std::move (convolution));
+    }
+
+    if (impulseResponseFile != juce::File())
+        for (auto& convolution : convolutions)
+            convolution->loadImpulseResponse (impulseResponseFile, juce::dsp::Convolution::Stereo::yes,
+                                              juce::dsp::Convolution::Trim::yes, 0, juce::dsp::Convolution::Normalise::yes);
+
+    dryBuffer.setSize (numChannels, maximumBlockSize);
+    maxBlockSize = maximumBlockSize;
+
+    wetGain.reset (sampleRate, rampSeconds);
+    wetGain.setCurrentAndTargetValue (wetGain.getTargetValue());
+}
+
+void CabinetStage::loadImpulseResponse (const juce::File& file)
+{
+    const juce::ScopedLock sl (fileLock);
+
+    impulseResponseFile = file;
+    hasImpulseResponse = true;
+
+    for (auto& convolution : convolutions)
+        convolution->loadImpulseResponse (file, juce::dsp::Convolution::Stereo::yes,
+                                          juce::dsp::Convolution::Trim::yes, 0, juce::dsp::Convolution::Normalise::yes);
+}
+
+void CabinetStage::clearImpulseResponse()
+{
+    const juce::ScopedLock sl (fileLock);
+
+    impulseResponseFile = juce::File();
+    hasImpulseResponse = false;
+
+    // Frees the old IR on the loader thread
+    for (auto& convolution : convolutions)
+        convolution->loadImpulseResponse (juce::AudioBuffer<float>(), 0.0, juce::dsp::Convolution::Stereo::no,
+                                          juce::dsp::Convolution::Trim::no, juce::dsp::Convolution::Normalise::no);
+}
+
+juce::File CabinetStage::getImpulseResponseFile() const
+{
+    const juce::ScopedLock sl (fileLock);
+    return impulseResponseFile;
+}
+
+void CabinetStage::setEnabled (bool shouldBeEnabled) noexcept
+{
+    const float target = shouldBeEnabled ? 1.0f : 0.0f;
+
+    if (target == wetGain.getTargetValue())
+        return;
+
+    // Coming back from fully off: the tails of the last run are stale
+    if (shouldBeEnabled && ! wetGain.isSmoothing())
+        for (auto& convolution : convolutions)
+            convolution->reset();
+
+    wetGain.setTargetValue (target);
+}
+
+void CabinetStage::process (juce::dsp::AudioBlock<float> block) noexcept
+{
+    if (convolutions.empty() || ! hasImpulseResponse.load() || (! wetGain.isSmoothing() && wetGain.getTargetValue() == 0.0f))
+        return;
+
+    // The convolutions are prepared for at most maxBlockSize samples at a time
+    for (size_t start = 0; start < block.getNumSamples(); start += (size_t) maxBlockSize)
+        processChunk (block.getSubBlock (start, juce::jmin ((size_t) maxBlockSize, block.getNumSamples() - start)));
+}
+
+void CabinetStage::processChunk (juce::dsp::AudioBlock<float> chunk) noexcept
+{
+    const int numChannels = juce::jmin ((int) chunk.getNumChannels(), dryBuffer.getNumChannels());
+    const int numSamples = (int) chunk.getNumSamples();
+    const bool ramping = wetGain.isSmoothing();
+
+    if (ramping)
+        for (int ch = 0; ch < numChannels; ++ch)
+            dryBuffer.copyFrom (ch, 0, chunk.getChannelPointer ((size_t) ch), numSamples);
+
+    for (int ch = 0, pair = 0; ch < numChannels; ch += 2, ++pair)
+    {
+        auto channels = chunk.getSubsetChannelBlock ((size_t) ch, (size_t) juce::jmin (2, numChannels - ch));
+        convolutions[(size_t) pair]->process (juce::dsp::ProcessContextReplacing<float> (channels));
+    }
+
+    if (! ramping)
+        return;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float gain = wetGain.getNextValue();
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float dry = dryBuffer.getSample (ch, i);
+            float* out = chunk.getChannelPointer ((size_t) ch);
+            out[i] = dry + gain * (out[i] - dry);
+        }
+    }
+}
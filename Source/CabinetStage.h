@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    CabinetStage.h
+    Optional impulse-response (cabinet) convolution after the band sum.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Convolves the plugin's output with a cabinet or room impulse response, so that
+    Prism can feed a mixer directly instead of through a separate IR loader.
+
+    The convolution is non-uniformly partitioned: the head of the IR runs in small
+    FFT partitions inside the block, without added latency, and the tail in larger
+    ones, which keep long IRs cheap. Reading the IR file, resampling it to the
+    session rate and preparing its partitions happen on a background thread; the
+    audio thread keeps the current IR until the new one is ready and then
+    crossfades to it.
+
+    Channels are convolved in pairs, each with the (mono or stereo) IR. Switching
+    the stage on or off ramps between the dry and the convolved signal.
+*/
+class CabinetStage
+{
+public:
+    static constexpr int headSize = 128;            // samples in the zero-latency head partitions
+    static constexpr double rampSeconds = 0.02;
+
+    CabinetStage();
+    ~CabinetStage();
+
+    /** Allocates the convolutions for a layout and reloads the current IR. Not for the audio thread. */
+    void prepare (double sampleRate, int numChannels, int maximumBlockSize);
+
+    /** Starts loading an IR file in the background. Not for the audio thread. */
+    void loadImpulseResponse (const juce::File& file);
+    void clearImpulseResponse();
+    juce::File getImpulseResponseFile() const;
+
+    /** Audio thread. */
+    void setEnabled (bool shouldBeEnabled) noexcept;
+    void process (juce::dsp::AudioBlock<float> block) noexcept;
+
+private:
+    void processChunk (juce::dsp::AudioBlock<float> chunk) noexcept;
+
+    juce::dsp::ConvolutionMessageQueue loadQueue;       // the background thread of every pair
+    std::vector<std::unique_ptr<juce::dsp::Convolution>> convolutions;
+
+    juce::CriticalSection fileLock;                     // prepare() vs. loading, never on the audio thread
+    juce::File impulseResponseFile;
+    std::atomic<bool> hasImpulseResponse { false };    // without one the stage is skipped
+
+    juce::AudioBuffer<float> dryBuffer;
+    juce::SmoothedValue<float> wetGain;
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CabinetStage)
+};
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    ConditioningCache.cpp
+    Per-band FiLM coefficients, recomputed only when a band's settings change.
+
+  ==============================================================================
+*/
+
+#include "ConditioningCache.h"
+
+void ConditioningCache::prepare (const PrismModel& m)
+{
+    model = &m;
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        for (auto& slot : slots[(size_t) band])
+            slot.assign ((size_t) model->getFiLMSize(), 0.0f);
+
+        targets[(size_t) band].assign ((size_t) model->getFiLMSize(), 0.0f);
+        slopes[(size_t) band].assign ((size_t) model->getFiLMSize(), 0.0f);
+
+        active[(size_t) band].store (0, std::memory_order_relaxed);
+    }
+
+    invalidate();
+}
+
+void ConditioningCache::invalidate() noexcept
+{
+    for (auto& settings : cached)
+        settings = Settings();
+
+    rampRemaining.fill (0);
+}
+
+void ConditioningCache::makeSnapshot (const std::array<Settings, NUM_BANDS>& settings, Snapshot& snapshot) const
+{
+    jassert (model != nullptr);
+
+    const auto filmSize = (size_t) model->getFiLMSize();
+
+    snapshot.settings = settings;
+    snapshot.film.resize (NUM_BANDS * filmSize);
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        const auto& s = settings[(size_t) band];
+        model->computeFiLM (band, s.effect, s.gain, s.tone, snapshot.film.data() + (size_t) band * filmSize);
+    }
+}
+
+void ConditioningCache::applySnapshot (const Snapshot& snapshot, int rampLength) noexcept
+{
+    jassert (model != nullptr && snapshot.film.size() == (size_t) (NUM_BANDS * model->getFiLMSize()));
+
+    const auto filmSize = (size_t) model->getFiLMSize();
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        const float* film = snapshot.film.data() + (size_t) band * filmSize;
+        cached[(size_t) band] = snapshot.settings[(size_t) band];
+
+        if (rampLength <= 0)
+        {
+            setActive (band, film);
+            rampRemaining[(size_t) band] = 0;
+            continue;
+        }
+
+        // From wherever the band is now, including the middle of another ramp
+        const float* current = getFiLM (band);
+        const float step = 1.0f / (float) rampLength;
+        auto& target = targets[(size_t) band];
+
+        std::copy (film, film + filmSize, target.begin());
+
+        for (size_t i = 0; i < filmSize; ++i)
+            slopes[(size_t) band][i] = (target[i] - current[i]) * step;
+
+        rampRemaining[(size_t) band] = rampLength;
+    }
+}
+
+void ConditioningCache::setActive (int band, const float* film) noexcept
+{
+    const int next = 1 - active[(size_t) band].load (std::memory_order_relaxed);
+    std::copy (film, film + model->getFiLMSize(), slots[(size_t) band][(size_t) next].data());
+    active[(size_t) band].store (next, std::memory_order_release);
+}
+
+bool ConditioningCache::update (const std::array<Settings, NUM_BANDS>& settings, int rampLength) noexcept
+{
+    jassert (model != nullptr);
+
+    bool changed = false;
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        const auto& s = settings[(size_t) band];
+        const auto& previous = cached[(size_t) band];
+
+        if (s == previous)
+            continue;
+
+        // Land an unfinished ramp exactly on its target
+        if (rampRemaining[(size_t) band] > 0)
+        {
+            setActive (band, targets[(size_t) band].data());
+            rampRemaining[(size_t) band] = 0;
+        }
+
+        auto& target = targets[(size_t) band];
+        model->computeFiLM (band, s.effect, s.gain, s.tone, target.data());
+
+        if (rampLength > 0 && s.effect == previous.effect)
+        {
+            const float* current = getFiLM (band);
+            const float step = 1.0f / (float) rampLength;
+
+            for (size_t i = 0; i < target.size(); ++i)
+                slopes[(size_t) band][i] = (target[i] - current[i]) * step;
+
+            rampRemaining[(size_t) band] = rampLength;
+        }
+        else
+        {
+            setActive (band, target.data());
+        }
+
+        cached[(size_t) band] = s;
+        changed = true;
+    }
+
+    return changed;
+}
+
+void ConditioningCache::advance (int numSamples) noexcept
+{
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        auto& remaining = rampRemaining[(size_t) band];
+
+        if (remaining <= 0)
+            continue;
+
+        const int n = juce::jmin (numSamples, remaining);
+        remaining -= n;
+
+        if (remaining == 0)
+        {
+            setActive (band, targets[(size_t) band].data());
+            continue;
+        }
+
+        const int next = 1 - active[(size_t) band].load (std::memory_order_relaxed);
+        auto* film = slots[(size_t) band][(size_t) next].data();
+
+        juce::FloatVectorOperations::copy (film, getFiLM (band), model->getFiLMSize());
+        juce::FloatVectorOperations::addWithMultiply (film, slopes[(size_t) band].data(), (float) n, model->getFiLMSize());
+        active[(size_t) band].store (next, std::memory_order_release);
+    }
+}
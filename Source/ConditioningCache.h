@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    ConditioningCache.h
+    Per-band FiLM coefficients, recomputed only when a band's settings change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PrismModel.h"
+
+//==============================================================================
+/**
+    Caches the FiLM coefficients of every band, keyed on its (effect, gain, tone).
+
+    Each band owns two coefficient buffers: update() writes a changed band into the
+    inactive one and then flips the active index, so a reader holding the current
+    buffer for the rest of a block never sees a half-written set, and the previous
+    coefficients stay available until the next change.
+
+    Gain and tone changes glide: the FiLM projection is linear in both, so a linear
+    ramp of the coefficients from the old settings to the new ones is exactly the
+    network conditioned on linearly automated parameters. update() computes the
+    target once and a per-sample slope, the engines apply the slope inside the
+    block, and advance() moves the current coefficients along the ramp. Effect
+    changes still switch at once.
+*/
+class ConditioningCache
+{
+public:
+    struct Settings
+    {
+        int effect = -1;
+        float gain = 0.0f;
+        float tone = 0.0f;
+
+        bool operator== (const Settings& other) const noexcept
+        {
+            return effect == other.effect && gain == other.gain && tone == other.tone;
+        }
+        bool operator!= (const Settings& other) const noexcept   { return ! operator== (other); }
+    };
+
+    /** The coefficients of every band for one set of settings, computed ahead of time
+        so that applySnapshot() can switch all bands at once without any projection.
+    */
+    struct Snapshot
+    {
+        std::array<Settings, NUM_BANDS> settings;
+        std::vector<float> film;    // [band][getFiLMSize()]
+    };
+
+    ConditioningCache() = default;
+
+    /** Allocates the buffers for a model and invalidates every band. */
+    void prepare (const PrismModel& model);
+
+    /** Recomputes the bands whose settings differ from the cached ones. Gain and tone
+        changes are reached over the next rampLength samples (0 to jump). A changed band
+        completes any unfinished ramp first; a steady one carries on with it. Returns true
+        if any band changed. Allocation-free.
+    */
+    bool update (const std::array<Settings, NUM_BANDS>& settings, int rampLength = 0) noexcept;
+
+    /** Moves the coefficients of ramping bands numSamples samples further. */
+    void advance (int numSamples) noexcept;
+
+    /** Forces every band to be recomputed on the next update(). */
+    void invalidate() noexcept;
+
+    /** Computes a snapshot of the given settings for the prepared model. Allocates. */
+    void makeSnapshot (const std::array<Settings, NUM_BANDS>& settings, Snapshot& snapshot) const;
+
+    /** Switches every band to a snapshot, over the next rampLength samples (0 to jump),
+        replacing any ramp. The coefficients are linear in the whole conditioning vector,
+        so the ramp also blends effect changes. Allocation-free.
+    */
+    void applySnapshot (const Snapshot& snapshot, int rampLength = 0) noexcept;
+
+    const float* getFiLM (int band) const noexcept
+    {
+        return slots[(size_t) band][(size_t) active[(size_t) band].load (std::memory_order_acquire)].data();
+    }
+
+    /** Per-sample change of getFiLM (band) during a ramp, or nullptr while the band is steady. */
+    const float* getFiLMSlope (int band) const noexcept
+    {
+        return rampRemaining[(size_t) band] > 0 ? slopes[(size_t) band].data() : nullptr;
+    }
+
+    const Settings& getSettings (int band) const noexcept   { return cached[(size_t) band]; }
+
+private:
+    const PrismModel* model = nullptr;
+    std::array<Settings, NUM_BANDS> cached;
+    std::array<std::array<std::vector<float>, 2>, NUM_BANDS> slots;
+    std::array<std::atomic<int>, NUM_BANDS> active {};
+
+    // Gain/tone ramps: coefficients at the end of the ramp and their per-sample step
+    std::array<std::vector<float>, NUM_BANDS> targets, slopes;
+    std::array<int, NUM_BANDS> rampRemaining {};
+
+    void setActive (int band, const float* film) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConditioningCache)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Crossover.cpp
+    Linkwitz-Riley band splitter feeding the per-band networks.
+
+  ==============================================================================
+*/
+
+#include "Crossover.h"
+
+const std::array<float, Crossover::numCrossovers> Crossover::frequencies = {
+    500.0f, 1000.0f, 1600.0f, 2700.0f, 4500.0f, 7400.0f, 12000.0f
+};
+
+void Crossover::prepare (double sampleRate, int numChannels, int /*maximumBlockSize*/)
+{
+    enum class Response { lowpass, highpass, allpass, identity };
+
+    // Keep the top crossover below Nyquist at low sample rates
+    const double maxFrequency = sampleRate * 0.45;
+    const double k = juce::MathConstants<double>::sqrt2;
+
+    for (int stage = 0; stage < numCrossovers; ++stage)
+    {
+        const double frequency = juce::jmin ((double) frequencies[(size_t) stage], maxFrequency);
+        const double g = std::tan (juce::MathConstants<double>::pi * frequency / sampleRate);
+        const double a1 = 1.0 / (1.0 + g * (g + k));
+        const double a2 = g * a1;
+        const double a3 = g * a2;
+
+        for (int half = 0; half < 2; ++half)
+        {
+            auto& section = sections[(size_t) (2 * stage + half)];
+
+            for (int band = 0; band < numVecs * lanes; ++band)
+            {
+                auto response = stage < band ? Response::highpass
+                              : band == stage ? Response::lowpass
+                              : (half == 0 ? Response::allpass : Response::identity);
+
+                double m0 = 0.0, m1 = 0.0, m2 = 0.0;
+
+                switch (response)
+                {
+                    case Response::lowpass:   m2 = 1.0; break;
+                    case Response::highpass:  m0 = 1.0; m1 = -k;  m2 = -1.0; break;
+                    case Response::allpass:   m0 = 1.0; m1 = -2.0 * k; break;
+                    case Response::identity:  m0 = 1.0; break;
+                }
+
+                const auto v = (size_t) (band / lanes);
+                const auto lane = (size_t) (band % lanes);
+
+                section.a1[v].set (lane, (float) a1);
+                section.a2[v].set (lane, (float) a2);
+                section.a3[v].set (lane, (float) a3);
+                section.m0[v].set (lane, (float) m0);
+                section.m1[v].set (lane, (float) m1);
+                section.m2[v].set (lane, (float) m2);
+            }
+        }
+    }
+
+    channels.resize ((size_t) numChannels);
+    reset();
+}
+
+void Crossover::reset()
+{
+    for (auto& state : channels)
+    {
+        for (int s = 0; s < numSections; ++s)
+        {
+            for (int v = 0; v < numVecs; ++v)
+            {
+                state.ic1[s][v] = Vec::expand (0.0f);
+                state.ic2[s][v] = Vec::expand (0.0f);
+            }
+        }
+    }
+}
+
+void Crossover::process (int channel, const float* input, float* const* bands, int numSamples) noexcept
+{
+    auto& state = channels[(size_t) channel];
+    const auto two = Vec::expand (2.0f);
+
+    alignas (64) float out[numVecs * lanes];
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        Vec x[numVecs];
+        for (int v = 0; v < numVecs; ++v)
+            x[v] = Vec::expand (input[n]);
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            const auto& c = sections[(size_t) s];
+
+            for (int v = 0; v < numVecs; ++v)
+            {
+                auto& ic1 = state.ic1[s][v];
+                auto& ic2 = state.ic2[s][v];
+
+                const auto v3 = x[v] - ic2;
+                const auto v1 = c.a1[v] * ic1 + c.a2[v] * v3;
+                const auto v2 = ic2 + c.a2[v] * ic1 + c.a3[v] * v3;
+                ic1 = two * v1 - ic1;
+                ic2 = two * v2 - ic2;
+
+                x[v] = c.m0[v] * x[v] + c.m1[v] * v1 + c.m2[v] * v2;
+            }
+        }
+
+        for (int v = 0; v < numVecs; ++v)
+            x[v].copyToRawArray (out + v * lanes);
+
+        for (int band = 0; band < NUM_BANDS; ++band)
+            bands[band][n] = out[band];
+    }
+}
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    Crossover.h
+    Linkwitz-Riley band splitter feeding the per-band networks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef NUM_BANDS
+ #define NUM_BANDS 8
+#endif
+
+//==============================================================================
+/**
+    Splits a signal into NUM_BANDS phase-coherent bands with LR4 crossovers.
+
+    The LR4 tree (split, then allpass every lower band with each higher crossover)
+    is flattened so that every band is the same chain of numCrossovers stages:
+
+        stage j <  band : LR4 highpass at frequency j
+        stage j == band : LR4 lowpass  at frequency j
+        stage j >  band : 2nd order allpass at frequency j (LR4 LP + HP)
+
+    One SIMD lane holds one band, so all bands are filtered together with the
+    same TPT state-variable sections and per-lane coefficients.
+*/
+class Crossover
+{
+public:
+    static constexpr int numCrossovers = NUM_BANDS - 1;
+
+    /** Crossover frequencies, matching the band edges shown in the editor. */
+    static const std::array<float, numCrossovers> frequencies;
+
+    Crossover() = default;
+
+    void prepare (double sampleRate, int numChannels, int maximumBlockSize);
+    void reset();
+
+    /** Splits numSamples samples of one channel into NUM_BANDS band buffers. */
+    void process (int channel, const float* input, float* const* bands, int numSamples) noexcept;
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int lanes = (int) Vec::SIMDNumElements;
+    static constexpr int numVecs = (NUM_BANDS + lanes - 1) / lanes;
+
+    // Each LR4 stage is two SVF sections; allpass stages use an identity second section
+    static constexpr int numSections = 2 * numCrossovers;
+
+    struct Section
+    {
+        Vec a1[numVecs], a2[numVecs], a3[numVecs];  // SVF coefficients
+        Vec m0[numVecs], m1[numVecs], m2[numVecs];  // output mix of input, band and low
+    };
+
+    struct ChannelState
+    {
+        Vec ic1[numSections][numVecs], ic2[numSections][numVecs];
+    };
+
+    std::array<Section, numSections> sections;
+    std::vector<ChannelState> channels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Crossover)
+};
@@ -0,0 +1,302 @@
+/*
+  ==============================================================================
+
+    InferenceScheduler.cpp
+    Process-wide batching of TCN inference across plugin instances.
+
+  ==============================================================================
+*/
+
+#include "InferenceScheduler.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    inline void cpuRelax() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+
+    juce::int64 secondsToTicks (double seconds)
+    {
+        return (juce::int64) (seconds * (double) juce::Time::getHighResolutionTicksPerSecond());
+    }
+}
+
+//==============================================================================
+InferenceScheduler::Client::Client (InferenceScheduler& scheduler)
+    : owner (scheduler)
+{
+    const juce::ScopedLock sl (owner.clientLock);
+    owner.clients.add (this);
+}
+
+InferenceScheduler::Client::~Client()
+{
+    cancel();
+
+    const juce::ScopedLock sl (owner.clientLock);
+    owner.clients.removeFirstMatchingValue (this);
+}
+
+void InferenceScheduler::Client::cancel()
+{
+    // A round holds the lock until its shards are done, so none is running this client past here
+    const juce::ScopedLock sl (owner.clientLock);
+
+    if (state.exchange (idle) == submitted)
+        --owner.numPending;
+}
+
+void InferenceScheduler::Client::prepare (const std::vector<TCNEngine*>& newEngines, int maximumFrameSize,
+                                          double frameDurationSeconds)
+{
+    cancel();
+
+    const juce::ScopedLock sl (owner.clientLock);
+
+    engines = newEngines;
+
+    films.assign (engines.size(), nullptr);
+    filmSlopes.assign (engines.size(), nullptr);
+    streams.setSize ((int) engines.size(), maximumFrameSize);
+    frameSeconds = frameDurationSeconds;
+}
+
+void InferenceScheduler::Client::submit (int newNumSamples) noexcept
+{
+    jassert (! isBusy() && newNumSamples <= streams.getNumSamples());
+
+    numSamples = newNumSamples;
+    state.store (submitted, std::memory_order_release);
+
+    // The first client of a round starts the gather window, the last expected one closes it
+    const int pending = ++owner.numPending;
+
+    if (pending == 1)
+        owner.gatherDeadline.store (juce::Time::getHighResolutionTicks() + secondsToTicks (0.25 * frameSeconds));
+
+    if (pending == 1 || pending >= owner.numExpected.load())
+        owner.wakeWorker();
+}
+
+bool InferenceScheduler::Client::collect (WorkerPool& pool) noexcept
+{
+    int expected = submitted;
+
+    // Not started by any shard: run it here rather than wait for the scheduler to get to it
+    if (state.compare_exchange_strong (expected, processing, std::memory_order_acq_rel))
+    {
+        --owner.numPending;
+
+        auto task = [this] (int stream) { processStream (stream); };
+        pool.run (getNumStreams(), task);
+
+        state.store (idle, std::memory_order_release);
+        return false;
+    }
+
+    // A shard is on it already, and it has been running since before we got here
+    while (isBusy())
+        cpuRelax();
+
+    return true;
+}
+
+void InferenceScheduler::Client::processStream (int stream) noexcept
+{
+    auto* engine = engines[(size_t) stream];
+    const auto* film = films[(size_t) stream];
+
+    if (film != nullptr && engine != nullptr && engine->isPrepared())
+        engine->process (getStreamBuffer (stream), getStreamBuffer (stream), numSamples, film, filmSlopes[(size_t) stream]);
+}
+
+//==============================================================================
+InferenceScheduler::InferenceScheduler()
+    : juce::Thread ("Prism inference scheduler")
+{
+    // The scheduler thread takes a shard itself, so the helpers make up the other cores
+    workers->prepare (juce::SystemStats::getNumCpus() - 1);
+    startThread (juce::Thread::Priority::highest);
+}
+
+InferenceScheduler::~InferenceScheduler()
+{
+    signalThreadShouldExit();
+    wakeWorker();
+    stopThread (1000);
+}
+
+void InferenceScheduler::wakeWorker() noexcept
+{
+    ++wakeWord;
+
+    if (numSleeping.load() > 0)
+        parking.wakeAll (wakeWord, 1);
+}
+
+void InferenceScheduler::sleep (juce::uint32 seen, int timeoutMs) noexcept
+{
+    // Announced before the word is checked, so that a waker either sees the sleeper or changed
+    // the word first
+    ++numSleeping;
+    parking.wait (wakeWord, seen, timeoutMs);
+    --numSleeping;
+}
+
+void InferenceScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        // Read before the condition, so that a submit after the check changes the word we sleep on
+        auto seen = wakeWord.load();
+
+        if (numPending.load() == 0)
+        {
+            sleep (seen, 100);
+            continue;
+        }
+
+        // Give the other instances of this host cycle a chance to join the batch
+        while (! threadShouldExit())
+        {
+            seen = wakeWord.load();
+
+            if (numPending.load() >= numExpected.load())
+                break;
+
+            const auto remaining = gatherDeadline.load() - juce::Time::getHighResolutionTicks();
+
+            if (remaining <= 0)
+                break;
+
+            sleep (seen, juce::jmax (1, (int) (1000.0 * juce::Time::highResolutionTicksToSeconds (remaining))));
+        }
+
+        processPending();
+    }
+}
+
+void InferenceScheduler::processPending()
+{
+    const juce::ScopedLock sl (clientLock);
+
+    // Only gathered here: each shard claims its clients as it starts, so until then their audio
+    // threads can still take a frame back
+    batch.clearQuick();
+
+    size_t numStreams = 0;
+
+    for (auto* client : clients)
+    {
+        if (client->state.load (std::memory_order_acquire) == Client::submitted)
+        {
+            batch.add (client);
+            numStreams += (size_t) client->getNumStreams();
+        }
+    }
+
+    if (batch.isEmpty())
+        return;
+
+    numExpected = batch.size();
+
+    const int numShards = juce::jlimit (1, juce::jmin ((int) shards.size(), workers->getNumWorkers() + 1),
+                                        batch.size() / minClientsPerShard);
+
+    for (int s = 0; s < numShards; ++s)
+    {
+        auto& shard = shards[(size_t) s];
+        shard.begin = batch.size() * s / numShards;
+        shard.end = batch.size() * (s + 1) / numShards;
+
+        // Grown here, so that the pool's real-time helpers do not allocate
+        shard.claimed.ensureStorageAllocated (shard.end - shard.begin);
+        shard.pendingStreams.reserve (numStreams);
+        shard.engines.reserve (numStreams);
+        shard.buffers.reserve (numStreams);
+        shard.films.reserve (numStreams);
+        shard.filmSlopes.reserve (numStreams);
+        shard.lengths.reserve (numStreams);
+    }
+
+    auto task = [this] (int s) { processShard (shards[(size_t) s]); };
+    workers->run (numShards, task);
+}
+
+void InferenceScheduler::processShard (Shard& shard) noexcept
+{
+    shard.claimed.clearQuick();
+    shard.pendingStreams.clear();
+
+    for (int i = shard.begin; i < shard.end; ++i)
+    {
+        auto* client = batch.getUnchecked (i);
+        int expected = Client::submitted;
+
+        // Its audio thread may have taken the frame back in the meantime
+        if (! client->state.compare_exchange_strong (expected, Client::processing, std::memory_order_acq_rel))
+            continue;
+
+        --numPending;
+        shard.claimed.add (client);
+
+        for (int s = 0; s < client->getNumStreams(); ++s)
+            if (client->films[(size_t) s] != nullptr && client->engines[(size_t) s] != nullptr
+                 && client->engines[(size_t) s]->isPrepared())
+                shard.pendingStreams.push_back ({ client->engines[(size_t) s], client->getStreamBuffer (s),
+                                                  client->films[(size_t) s], client->filmSlopes[(size_t) s],
+                                                  client->numSamples });
+    }
+
+    auto& pendingStreams = shard.pendingStreams;
+
+    // Streams can only share a batch if they run the same weights at the same dilations and precision
+    while (! pendingStreams.empty())
+    {
+        const auto* model = pendingStreams.front().engine->getModel();
+        const int scale = pendingStreams.front().engine->getDilationScale();
+        const auto precision = pendingStreams.front().engine->getPrecision();
+
+        shard.engines.clear();
+        shard.buffers.clear();
+        shard.films.clear();
+        shard.filmSlopes.clear();
+        shard.lengths.clear();
+
+        auto sameGroup = [&] (const Stream& stream)
+        {
+            return stream.engine->getModel() == model && stream.engine->getDilationScale() == scale
+                    && stream.engine->getPrecision() == precision;
+        };
+
+        for (auto& stream : pendingStreams)
+        {
+            if (sameGroup (stream))
+            {
+                shard.engines.push_back (stream.engine);
+                shard.buffers.push_back (stream.buffer);
+                shard.films.push_back (stream.film);
+                shard.filmSlopes.push_back (stream.filmSlope);
+                shard.lengths.push_back (stream.numSamples);
+            }
+        }
+
+        TCNEngine::processBatch (shard.engines.data(), shard.buffers.data(), shard.films.data(), shard.filmSlopes.data(),
+                                 shard.lengths.data(), (int) shard.engines.size(), shard.scratch);
+
+        pendingStreams.erase (std::remove_if (pendingStreams.begin(), pendingStreams.end(), sameGroup),
+                              pendingStreams.end());
+    }
+
+    for (auto* client : shard.claimed)
+        client->state.store (Client::idle, std::memory_order_release);
+}
@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    InferenceScheduler.h
+    Process-wide batching of TCN inference across plugin instances.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "TCNEngine.h"
+#include "Parking.h"
+#include "WorkerPool.h"
+
+//==============================================================================
+/**
+    Runs the band networks of every participating plugin instance in batches with
+    TCNEngine::processBatch(), shared out across the process's WorkerPool.
+
+    Each instance owns a Client. Once per frame its audio thread fills the client's
+    stream buffers (one per channel and band) and submits them. When every
+    instance seen in the previous round has submitted, or a quarter of a frame
+    after the first one did, the scheduler thread splits the pending clients into
+    shards, one per available core, and the pool runs the shards side by side. A
+    shard groups its clients' streams by model and dilation scale and runs each
+    group as one batch. The instance collects the result on its next frame, so
+    batching costs one frame of latency and lets the work overlap the host's own
+    processing.
+
+    A frame that no shard has started by then is taken back and run on the
+    instance's own audio thread instead, so a late scheduler costs CPU time rather
+    than audio. The audio thread only touches atomics, and makes a system call to
+    wake the scheduler only if it is asleep (see Parking).
+*/
+class InferenceScheduler  : private juce::Thread
+{
+public:
+    InferenceScheduler();
+    ~InferenceScheduler() override;
+
+    //==============================================================================
+    class Client
+    {
+    public:
+        explicit Client (InferenceScheduler& scheduler);
+        ~Client();
+
+        /** Binds the client to an instance's engines, one stream per engine. Call with
+            processing stopped. frameDuration is the real time covered by a full frame.
+        */
+        void prepare (const std::vector<TCNEngine*>& engines, int maximumFrameSize, double frameDurationSeconds);
+
+        /** Rebinds one stream, e.g. to a network swapped in. A null engine leaves the stream
+            unused. Only while the client is not busy.
+        */
+        void setEngine (int stream, TCNEngine* engine) noexcept
+        {
+            jassert (! isBusy());
+            engines[(size_t) stream] = engine;
+        }
+
+        int getNumStreams() const noexcept                  { return (int) engines.size(); }
+        float* getStreamBuffer (int stream) noexcept        { return streams.getWritePointer (stream); }
+        const float* getStreamBuffer (int stream) const noexcept { return streams.getReadPointer (stream); }
+
+        /** Withdraws a submitted frame, waiting if the worker is already running it. Afterwards
+            the engines can be rebuilt. Not for the audio thread.
+        */
+        void cancel();
+
+        /** Sets the FiLM coefficients (and optional per-sample slope, see TCNEngine::process())
+            used for a stream by the next submit(). A null film leaves the stream (buffer and
+            engine) untouched for that frame.
+        */
+        void setFiLM (int stream, const float* film, const float* slope = nullptr) noexcept
+        {
+            films[(size_t) stream] = film;
+            filmSlopes[(size_t) stream] = slope;
+        }
+
+        /** Hands the first numSamples samples of every stream buffer to the scheduler.
+            The buffers and engines must not be touched until collect() returns.
+        */
+        void submit (int numSamples) noexcept;
+
+        /** Makes sure the submitted frame is processed. A frame the scheduler has not started
+            is taken back and run here, split across pool; one it is running is waited for,
+            which takes no longer than its shard. Returns false if the frame ran here.
+        */
+        bool collect (WorkerPool& pool) noexcept;
+
+        bool isBusy() const noexcept        { return state.load (std::memory_order_acquire) != idle; }
+
+    private:
+        friend class InferenceScheduler;
+
+        enum State { idle, submitted, processing };
+
+        void processStream (int stream) noexcept;
+
+        InferenceScheduler& owner;
+        std::vector<TCNEngine*> engines;
+        std::vector<const float*> films, filmSlopes;
+        juce::AudioBuffer<float> streams;
+        int numSamples = 0;
+        double frameSeconds = 0.0;
+        std::atomic<int> state { idle };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Client)
+    };
+
+private:
+    struct Shard;
+
+    void run() override;
+    void processPending();
+    void processShard (Shard&) noexcept;
+
+    // A shard of one client would lose the weight reuse across instances that batching is for
+    static constexpr int minClientsPerShard = 2;
+
+    juce::CriticalSection clientLock;   // registration vs. a round, never on the audio thread
+    juce::Array<Client*> clients;
+    juce::SharedResourcePointer<WorkerPool> workers;
+
+    void wakeWorker() noexcept;
+    void sleep (juce::uint32 seen, int timeoutMs) noexcept;
+
+    Parking parking;
+    std::atomic<juce::uint32> wakeWord { 0 };       // bumped for every wake-up, what the worker sleeps on
+    std::atomic<int> numSleeping { 0 };
+    std::atomic<int> numPending { 0 }, numExpected { 0 };
+    std::atomic<juce::int64> gatherDeadline { 0 };
+
+    // Working memory of a round: the clients that had submitted, and per shard a slice of them
+    struct Stream
+    {
+        TCNEngine* engine;
+        float* buffer;
+        const float* film;
+        const float* filmSlope;
+        int numSamples;
+    };
+
+    struct Shard
+    {
+        int begin = 0, end = 0;             // into batch
+        juce::Array<Client*> claimed;       // the clients this shard took over
+        std::vector<Stream> pendingStreams;
+        std::vector<TCNEngine*> engines;
+        std::vector<float*> buffers;
+        std::vector<const float*> films, filmSlopes;
+        std::vector<int> lengths;
+        TCNEngine::BatchScratch scratch;
+    };
+
+    juce::Array<Client*> batch;
+    std::array<Shard, WorkerPool::maxWorkers + 1> shards;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InferenceScheduler)
+};
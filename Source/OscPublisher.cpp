@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    OscPublisher.cpp
+    Coalescing, rate-limited OSC parameter publisher.
+
+  ==============================================================================
+*/
+
+#include "OscPublisher.h"
+
+OscPublisher::OscPublisher (juce::OSCSender& sender, const juce::StringArray& parameterIDs, int intervalMs)
+    : juce::Thread ("Prism OSC publisher"),
+      oscSender (sender),
+      ids (parameterIDs),
+      slots (std::make_unique<Slot[]> ((size_t) parameterIDs.size())),
+      interval (juce::jmax (1, intervalMs))
+{
+    startThread (juce::Thread::Priority::low);
+}
+
+OscPublisher::~OscPublisher()
+{
+    stopThread (1000);
+}
+
+void OscPublisher::publish (int parameterIndex, float newValue) noexcept
+{
+    if (! juce::isPositiveAndBelow (parameterIndex, ids.size()))
+        return;
+
+    auto& slot = slots[(size_t) parameterIndex];
+    slot.value.store (newValue, std::memory_order_relaxed);
+    slot.dirty.store (true, std::memory_order_release);
+    anyDirty.store (true, std::memory_order_release);
+}
+
+void OscPublisher::setStatusProvider (std::function<juce::OSCMessage()> provider, int intervalMs)
+{
+    const juce::SpinLock::ScopedLockType sl (statusLock);
+    statusProvider = std::move (provider);
+    statusInterval = juce::jmax (interval, intervalMs);
+}
+
+void OscPublisher::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (interval);
+        flush();
+
+        const juce::SpinLock::ScopedLockType sl (statusLock);
+        const auto now = juce::Time::getMillisecondCounter();
+
+        if (statusProvider != nullptr && now - lastStatusTime >= (juce::uint32) statusInterval)
+        {
+            lastStatusTime = now;
+            oscSender.send (statusProvider());
+        }
+    }
+}
+
+void OscPublisher::flush()
+{
+    if (! anyDirty.exchange (false, std::memory_order_acquire))
+        return;
+
+    juce::OSCBundle bundle;
+
+    for (int i = 0; i < ids.size(); ++i)
+    {
+        auto& slot = slots[(size_t) i];
+
+        if (slot.dirty.exchange (false, std::memory_order_acquire) && ids[i].isNotEmpty())
+        {
+            juce::OSCMessage msg ("/parameterChanged");
+            msg.addString (ids[i]);
+            msg.addFloat32 (slot.value.load (std::memory_order_relaxed));
+            bundle.addElement (msg);
+        }
+    }
+
+    if (bundle.size() > 0)
+        oscSender.send (bundle);
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    OscPublisher.h
+    Coalescing, rate-limited OSC parameter publisher.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Publishes parameter changes to the OSC backend from a background thread.
+
+    publish() only stores the latest value of a parameter and raises its dirty
+    flag, so it is wait-free and can be called from the audio thread during host
+    automation. Every interval the thread collects the dirty parameters and sends
+    them as a single bundle of "/parameterChanged" messages: if a parameter moved
+    several times in between, only its last value goes out.
+*/
+class OscPublisher  : private juce::Thread
+{
+public:
+    OscPublisher (juce::OSCSender& sender, const juce::StringArray& parameterIDs, int intervalMs = 10);
+    ~OscPublisher() override;
+
+    /** Queues the latest value of a parameter, by its index in parameterIDs. Wait-free,
+        allocation-free.
+    */
+    void publish (int parameterIndex, float newValue) noexcept;
+
+    /** Sets a callback run on the publisher thread every intervalMs, whose message is
+        sent as a status report (e.g. audio-thread load). Pass nullptr to stop.
+    */
+    void setStatusProvider (std::function<juce::OSCMessage()> provider, int intervalMs = 500);
+
+private:
+    void run() override;
+    void flush();
+
+    struct Slot
+    {
+        std::atomic<float> value { 0.0f };
+        std::atomic<bool> dirty { false };
+    };
+
+    juce::OSCSender& oscSender;
+    const juce::StringArray ids;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<bool> anyDirty { false };
+    const int interval;
+
+    juce::SpinLock statusLock;
+    std::function<juce::OSCMessage()> statusProvider;
+    int statusInterval = 500;
+    juce::uint32 lastStatusTime = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OscPublisher)
+};
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    Parking.cpp
+    Lock-free sleep and wake-up on an atomic word.
+
+  ==============================================================================
+*/
+
+#include "Parking.h"
+
+#if JUCE_LINUX || JUCE_ANDROID
+ #include <climits>
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #pragma comment (lib, "Synchronization.lib")
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+ #include <ctime>
+#endif
+
+#if JUCE_LINUX || JUCE_ANDROID
+struct Parking::Semaphore {};
+
+Parking::Parking() = default;
+Parking::~Parking() = default;
+
+void Parking::wait (std::atomic<juce::uint32>& word, juce::uint32 value, int timeoutMs) noexcept
+{
+    const timespec timeout { timeoutMs / 1000, (long) (timeoutMs % 1000) * 1000000L };
+    syscall (SYS_futex, reinterpret_cast<juce::uint32*> (&word), FUTEX_WAIT_PRIVATE, value, &timeout, nullptr, 0);
+}
+
+void Parking::wakeAll (std::atomic<juce::uint32>& word, int) noexcept
+{
+    syscall (SYS_futex, reinterpret_cast<juce::uint32*> (&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#elif JUCE_WINDOWS
+struct Parking::Semaphore {};
+
+Parking::Parking() = default;
+Parking::~Parking() = default;
+
+void Parking::wait (std::atomic<juce::uint32>& word, juce::uint32 value, int timeoutMs) noexcept
+{
+    WaitOnAddress (&word, &value, sizeof (value), (DWORD) timeoutMs);
+}
+
+void Parking::wakeAll (std::atomic<juce::uint32>& word, int) noexcept
+{
+    WakeByAddressAll (&word);
+}
+
+#else
+// A semaphore posted once per announced sleeper. A thread that announced its sleep but then saw
+// the word change leaves a post behind, which only costs it a spurious wake-up.
+struct Parking::Semaphore
+{
+   #if JUCE_MAC || JUCE_IOS
+    Semaphore()     : semaphore (dispatch_semaphore_create (0)) {}
+    ~Semaphore()    { dispatch_release (semaphore); }
+
+    void sleep (int timeoutMs) noexcept
+    {
+        dispatch_semaphore_wait (semaphore, dispatch_time (DISPATCH_TIME_NOW, (int64_t) timeoutMs * (int64_t) NSEC_PER_MSEC));
+    }
+
+    void post() noexcept        { dispatch_semaphore_signal (semaphore); }
+
+    dispatch_semaphore_t semaphore;
+   #else
+    Semaphore()     { sem_init (&semaphore, 0, 0); }
+    ~Semaphore()    { sem_destroy (&semaphore); }
+
+    void sleep (int timeoutMs) noexcept
+    {
+        timespec deadline;
+        clock_gettime (CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+        deadline.tv_sec += timeoutMs / 1000 + deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        sem_timedwait (&semaphore, &deadline);
+    }
+
+    void post() noexcept        { sem_post (&semaphore); }
+
+    sem_t semaphore;
+   #endif
+};
+
+Parking::Parking()
+    : semaphore (std::make_unique<Semaphore>())
+{
+}
+
+Parking::~Parking() = default;
+
+void Parking::wait (std::atomic<juce::uint32>& word, juce::uint32 value, int timeoutMs) noexcept
+{
+    if (word.load() == value)
+        semaphore->sleep (timeoutMs);
+}
+
+void Parking::wakeAll (std::atomic<juce::uint32>&, int numSleepers) noexcept
+{
+    for (int i = 0; i < numSleepers; ++i)
+        semaphore->post();
+}
+#endif
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    Parking.h
+    Lock-free sleep and wake-up on an atomic word.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Where threads that have run out of work sleep until an audio thread has more.
+
+    A thread only goes to sleep if the word still holds the value it has seen, so
+    a change published in between is never missed, and waking takes no lock on
+    the waking side: a futex on Linux, an address wait on Windows, a semaphore
+    elsewhere. Sleepers count themselves before they wait, and wakers only make
+    the system call if someone is asleep.
+
+    Waits can return early; callers check their condition again.
+*/
+class Parking
+{
+public:
+    Parking();
+    ~Parking();
+
+    /** Sleeps for at most timeoutMs unless word no longer holds value. */
+    void wait (std::atomic<juce::uint32>& word, juce::uint32 value, int timeoutMs) noexcept;
+
+    /** Wakes the threads waiting on word, after the caller has changed it. numSleepers is
+        how many announced their sleep; only the semaphore fallback needs it.
+    */
+    void wakeAll (std::atomic<juce::uint32>& word, int numSleepers) noexcept;
+
+private:
+    struct Semaphore;       // where there is no address wait
+    std::unique_ptr<Semaphore> semaphore;
+
+    JUCE_DECLARE_NON_COPYABLE (Parking)
+};
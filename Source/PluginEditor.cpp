@@ -91,12 +91,35 @@ MBDistEditor::MBDistEditor (MBDistProcessor& p)
     // programButton.setLookAndFeel(&invisibleButtonLaF);
     // programButton.onClick = [this]() { showFileMenu(&programButton); };
 
+    // Resolve the parameters the editor redraws on, once; afterwards it only hears about changes
+    for (int i = 0; i < bandSliders.size(); ++i)
+    {
+        const auto id = "Band" + juce::String(i + 1);
+        watchedParameters[i] = audioProcessor.apvts.getParameter(id);
+        watchedValues[i] = audioProcessor.apvts.getRawParameterValue(id);
+    }
+    watchedParameters[bypassSlot] = audioProcessor.apvts.getParameter("Bypass");
+    watchedValues[bypassSlot] = audioProcessor.apvts.getRawParameterValue("Bypass");
+
+    for (auto* param : watchedParameters)
+        param->addListener(this);
+
+    for (auto& effect : MBDistProcessor::bandEffects)
+        effectColoursByIndex.push_back(effectTypeColors.at(effect));
+
+    // The artwork covers the whole window, so nothing behind the editor needs painting
+    setOpaque(true);
+    timerCallback();
+
     Timer::startTimerHz(25); // 25 Hz update rate for Program change to update label
 }
 
 
 MBDistEditor::~MBDistEditor()
 {
+    for (auto* param : watchedParameters)
+        param->removeListener(this);
+
     // Reset attachments
     // driveAttachment.reset();
     // depthAttachment.reset();
@@ -132,25 +155,44 @@ MBDistEditor::~MBDistEditor()
 //==============================================================================
 void MBDistEditor::paint (juce::Graphics& g)
 {
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+    // Background, pedal artwork and band labels only change with the window size (or display)
+    const float pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (staticLayer.isNull() || staticLayerScale != pixelScale)
+        renderStaticLayer (pixelScale);
+
+    g.drawImageTransformed (staticLayer, juce::AffineTransform::scale (1.0f / staticLayerScale));
+
+    for (int i = 0; i < bandSliders.size(); ++i)
+    {
+        g.setColour(bandColors[i]);
+        g.fillRoundedRectangle(bandKnobPanels[i], panelCornerSize);
+        g.fillRoundedRectangle(bandSliderPanels[i], panelCornerSize);
+    }
+
+    auto& led = bypass ? ledOff_png_drawable : ledOn_png_drawable;
+    led->drawWithin(
+        g,
+        ledArea.toFloat(),
+        juce::RectanglePlacement::fillDestination
+        | juce::RectanglePlacement::xLeft | juce::RectanglePlacement::yTop,
+        1.0f);
+}
 
+void MBDistEditor::renderStaticLayer (float pixelScale)
+{
     auto area = getLocalBounds();
-    // Calculate scale factors
-    float scaleX = area.getWidth() / (float)ORIGIN_WIDTH;
-    float scaleY = area.getHeight() / (float)ORIGIN_HEIGHT;
-    
-    // Use the smaller scale factor to maintain aspect ratio
-    float scale = juce::jmin(scaleX, scaleY);
-    
-    // Center the scaled content
-    float scaledWidth = ORIGIN_WIDTH * scale;
-    float scaledHeight = ORIGIN_HEIGHT * scale;
-    float xOffset = (area.getWidth() - scaledWidth) * 0.5f;
-    float yOffset = (area.getHeight() - scaledHeight) * 0.5f;
 
-    // Create and apply transform
-    juce::AffineTransform transform = juce::AffineTransform::scale(scale)
-                                        .translated(xOffset, yOffset);
+    staticLayerScale = pixelScale;
+    staticLayer = juce::Image (juce::Image::RGB,
+                               juce::jmax (1, juce::roundToInt (area.getWidth() * pixelScale)),
+                               juce::jmax (1, juce::roundToInt (area.getHeight() * pixelScale)),
+                               false);
+
+    juce::Graphics g (staticLayer);
+    g.addTransform (juce::AffineTransform::scale (pixelScale));
+
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 
     background_jpg_drawable->drawWithin(
         g, 
@@ -168,35 +210,42 @@ void MBDistEditor::paint (juce::Graphics& g)
         1.0f
     );
 
-    // juce::Colour ledColour = bypass ? juce::Colour::fromString("#ff3c3c3c") : juce::Colour::fromString("#ffcb7bdd");
+    g.setColour(juce::Colours::black);
+    g.setFont(_MBDistLaF.mainFont.withHeight(bandTextHeight));
+
+    for (int i = 0; i < bandSliders.size(); ++i)
+        g.drawText(bandFrequencies[i].first, bandTextAreas[i], juce::Justification::left);
+
+    g.drawText(bandFrequencies.back().second, bandEndTextArea, juce::Justification::right);
+}
+
+void MBDistEditor::resized()
+{
+    // All layout happens here, once per size change, never in paint()
+    auto area = getLocalBounds();
+    // Calculate scale factors
+    float scaleX = area.getWidth() / (float)ORIGIN_WIDTH;
+    float scaleY = area.getHeight() / (float)ORIGIN_HEIGHT;
+    
+    // Use the smaller scale factor to maintain aspect ratio
+    float scale = juce::jmin(scaleX, scaleY);
+    
+    // Center the scaled content
+    float scaledWidth = ORIGIN_WIDTH * scale;
+    float scaledHeight = ORIGIN_HEIGHT * scale;
+    float xOffset = (area.getWidth() - scaledWidth) * 0.5f;
+    float yOffset = (area.getHeight() - scaledHeight) * 0.5f;
+
+    // Create and apply transform
+    juce::AffineTransform transform = juce::AffineTransform::scale(scale)
+                                        .translated(xOffset, yOffset);
+
     int lexX = 440, ledY = 320;
     // affine transform for led
     transform.transformPoint(lexX, ledY);
     int ledW = 18, ledH = 18;
     transform.transformPoint(ledW, ledH);
-    juce::Rectangle<int> ledArea(lexX, ledY, ledW, ledH);
-    // g.setColour(ledColour);
-    // g.fillEllipse(lexX, ledY, 15, 15);
-    // g.setColour(juce::Colours::black);
-    // g.drawEllipse(lexX, ledY, 15, 15, 1.0f);
-
-    if (bypass)
-    {
-        ledOff_png_drawable->drawWithin(
-            g, 
-            ledArea.toFloat(), 
-            juce::RectanglePlacement::fillDestination
-            | juce::RectanglePlacement::xLeft | juce::RectanglePlacement::yTop,
-            1.0f);
-    } else {
-        ledOn_png_drawable->drawWithin(
-            g, 
-            ledArea.toFloat(), 
-            juce::RectanglePlacement::fillDestination
-            | juce::RectanglePlacement::xLeft | juce::RectanglePlacement::yTop,
-            1.0f
-        );
-    }
+    ledArea = juce::Rectangle<int>(lexX, ledY, ledW, ledH);
 
     const int BAND_WIDTH = 18;
     const int BAND_HEIGHT = 90;
@@ -216,9 +265,6 @@ void MBDistEditor::paint (juce::Graphics& g)
     const int margin = 10;
     for (int i = 0; i < bandSliders.size(); ++i)
     {
-        // g.setColour(juce::Colour::fromString("#ffd1d1d1"));
-        g.setColour(bandColors[i]);
-
         juce::Rectangle<int> gainToneArea(gainKnobX, gainKnobY, jmax(GAIN_KNOB_SIZE, toneKnobSize), (toneKnobY + toneKnobSize) - gainKnobY);
         auto expGainToneArea = gainToneArea.expanded(margin, margin).toFloat();
 
@@ -227,10 +273,10 @@ void MBDistEditor::paint (juce::Graphics& g)
         int gt_w = expGainToneArea.getWidth();
         int gt_h = expGainToneArea.getHeight();
         transform.transformPoints(gt_x, gt_y, gt_w, gt_h);
-        auto transformedExpGainToneArea = juce::Rectangle<float>(gt_x, gt_y, gt_w, gt_h);
+        bandKnobPanels[i] = juce::Rectangle<float>(gt_x, gt_y, gt_w, gt_h);
         int cmargin = margin, cmargin2 = margin;
         transform.transformPoint(cmargin, cmargin2);
-        g.fillRoundedRectangle(transformedExpGainToneArea, cmargin/2.0f);
+        panelCornerSize = cmargin/2.0f;
 
         bandGainSliders[i].setBounds(juce::Rectangle<int>(gainKnobX, gainKnobY, GAIN_KNOB_SIZE, GAIN_KNOB_SIZE));
         gainKnobX += offsetX;
@@ -243,29 +289,21 @@ void MBDistEditor::paint (juce::Graphics& g)
         int bandRR_w = expGainToneArea.getWidth();
         int bandRR_h = BAND_HEIGHT + 2 * margin;
         transform.transformPoints(bandRR_x, bandRR_y, bandRR_w, bandRR_h);
-        auto transformedBandRRArea = juce::Rectangle<float>(bandRR_x, bandRR_y, bandRR_w, bandRR_h);
-        g.fillRoundedRectangle(transformedBandRRArea, cmargin/2.0f);
+        bandSliderPanels[i] = juce::Rectangle<float>(bandRR_x, bandRR_y, bandRR_w, bandRR_h);
 
         bandSliders[i].setBounds(juce::Rectangle<int>(bandX, bandY, BAND_WIDTH, BAND_HEIGHT));
 
         int TEXT_HEIGHT = 15;
         transform.transformPoint(TEXT_HEIGHT, cmargin2);// cmargin2 reused, not used later
-
-        g.setColour(juce::Colours::black);
-        g.setFont(_MBDistLaF.mainFont.withHeight(TEXT_HEIGHT));
+        bandTextHeight = (float) TEXT_HEIGHT;
 
         int bandText_x = bandX - 40,
             bandText_y = textY+10,
             bandText_w = BAND_WIDTH + 20,
             bandText_h = TEXT_HEIGHT;
         transform.transformPoints(bandText_x, bandText_y, bandText_w, bandText_h);
+        bandTextAreas[i] = juce::Rectangle<int>(bandText_x, bandText_y, bandText_w, bandText_h);
 
-        g.drawText(bandFrequencies[i].first,
-                   bandText_x,
-                   bandText_y,
-                   bandText_w,
-                   bandText_h,
-                   juce::Justification::left);
         if (i == bandSliders.size() -1)
         {
             int bandend_x = bandX - 10,
@@ -273,12 +311,7 @@ void MBDistEditor::paint (juce::Graphics& g)
                 bandend_w = BAND_WIDTH + 30,
                 bandend_h = TEXT_HEIGHT;
             transform.transformPoints(bandend_x, bandend_textY, bandend_w, bandend_h);
-            g.drawText(bandFrequencies[i].second,
-                   bandend_x,
-                   bandend_textY,
-                   bandend_w,
-                   bandend_h,
-                   juce::Justification::right);
+            bandEndTextArea = juce::Rectangle<int>(bandend_x, bandend_textY, bandend_w, bandend_h);
         }
 
         bandX += offsetX;
@@ -291,9 +324,6 @@ void MBDistEditor::paint (juce::Graphics& g)
     const int webX = 76, webY = 341, webW = 179, webH = 53;
     websiteButton.setBounds(juce::Rectangle<int>(webX, webY, webW, webH));
 
-    
-    
-
     // Apply the transform to components
     for (int i = 0; i < bandSliders.size(); ++i)
     {
@@ -303,38 +333,60 @@ void MBDistEditor::paint (juce::Graphics& g)
     }
     bypassButton.setTransform(transform);
     websiteButton.setTransform(transform);
+
+    // Rasterised again by the next paint, at the new size
+    staticLayer = {};
+    _MBDistLaF.clearSpriteCache();
+    repaint();
 }
 
-void MBDistEditor::resized()
+void MBDistEditor::parameterValueChanged (int parameterIndex, float)
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-    // driveSlider->setBounds(0, 0, 50, getHeight());
-    // driveLabel->setBounds(0, getHeight() - 20, getWidth() / 3, 20);
-    repaint();
-    
+    // May be called on the audio thread: just mark the parameter
+    for (size_t slot = 0; slot < watchedParameters.size(); ++slot)
+    {
+        if (watchedParameters[slot]->getParameterIndex() == parameterIndex)
+        {
+            dirtyParameters.fetch_or (1u << slot, std::memory_order_release);
+            return;
+        }
+    }
 }
 
 void MBDistEditor::timerCallback()
 {
+    const auto dirty = dirtyParameters.exchange (0, std::memory_order_acquire);
+
+    if (dirty == 0)
+        return;
+
+    // Only what changed is repainted: a band's panels when its effect changes, the LED on bypass
     for (int i = 0; i < bandSliders.size(); ++i)
     {
-        // Assign colors based on Band[1-8] parameter
-        std::atomic<float>* bandParam = audioProcessor.apvts.getRawParameterValue("Band" + std::to_string(i + 1));
-        float bandValue = bandParam->load();
+        if ((dirty & (1u << i)) == 0)
+            continue;
+
+        const int effect = juce::jlimit(0, (int) effectColoursByIndex.size() - 1, (int) watchedValues[i]->load());
+        const auto effectColor = effectColoursByIndex[(size_t) effect];
 
-        juce::String effectType = MBDistProcessor::bandEffects[(int)bandValue];
-        juce::Colour effectColor = effectTypeColors.at(effectType.toStdString());
-        bandColors[i] = effectColor;
+        if (effectColor != bandColors[i])
+        {
+            bandColors[i] = effectColor;
+            repaint(bandKnobPanels[i].getSmallestIntegerContainer());
+            repaint(bandSliderPanels[i].getSmallestIntegerContainer());
+        }
     }
 
-    // Bypass
-    std::atomic<float>* bypassParam = audioProcessor.apvts.getRawParameterValue("Bypass");
-    float bypassValue = bypassParam->load();
-    
-    bypass = (bypassValue >= 0.5f);
+    if ((dirty & (1u << bypassSlot)) != 0)
+    {
+        const bool newBypass = watchedValues[bypassSlot]->load() >= 0.5f;
 
-    repaint();
+        if (newBypass != bypass)
+        {
+            bypass = newBypass;
+            repaint(ledArea);
+        }
+    }
 }
 
 void MBDistEditor::showFileMenu(juce::TextButton* button)
@@ -15,7 +15,9 @@ typedef juce::AudioProcessorValueTreeState::ButtonAttachment ButtonAttachment;
 //==============================================================================
 /**
 */
-class MBDistEditor  : public juce::AudioProcessorEditor, private juce::Timer
+class MBDistEditor  : public juce::AudioProcessorEditor,
+                      private juce::Timer,
+                      private juce::AudioProcessorParameter::Listener
 {
 public:
     MBDistEditor (MBDistProcessor&);
@@ -26,6 +28,7 @@ public:
     void resized() override;
 private:
     void showFileMenu(juce::TextButton*);
+    void renderStaticLayer(float pixelScale);
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     MBDistProcessor& audioProcessor;
@@ -77,7 +80,27 @@ private:
         {"Fuzz", juce::Colour::fromString("#88ff0303")}
     };
 
+    // effectTypeColors in MBDistProcessor::bandEffects order, looked up by choice index
+    std::vector<juce::Colour> effectColoursByIndex;
+
     std::array<juce::Colour, 8> bandColors = {};
+
+    // Parameters the editor redraws on, resolved once. The listener callbacks (possibly on
+    // the audio thread) only set a bit in dirtyParameters; the timer does the rest.
+    static constexpr int bypassSlot = 8;
+    std::array<juce::RangedAudioParameter*, 9> watchedParameters {};   // Band1..Band8, Bypass
+    std::array<std::atomic<float>*, 9> watchedValues {};
+    std::atomic<juce::uint32> dirtyParameters { ~0u };
+
+    // Layout computed in resized(), in window coordinates
+    std::array<juce::Rectangle<float>, 8> bandKnobPanels, bandSliderPanels;
+    std::array<juce::Rectangle<int>, 8> bandTextAreas;
+    juce::Rectangle<int> bandEndTextArea, ledArea;
+    float panelCornerSize = 5.0f, bandTextHeight = 15.0f;
+
+    // Background, pedal artwork and band labels, rasterised once per window size and display scale
+    juce::Image staticLayer;
+    float staticLayerScale = 1.0f;
                                     
     // Rotary sliders
     juce::Slider octave_knob{ "octave_knob"},
@@ -98,6 +121,8 @@ private:
     InvisibleTextButtonLookAndFeel invisibleButtonLaF;
 
     void timerCallback() override;
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int, bool) override {}
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBDistEditor)
 };
@@ -9,6 +9,108 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+//==============================================================================
+/** The "Tier" choice. It shows when the live tier has no network of its own, since the
+    choice then has no effect.
+*/
+class MBDistProcessor::TierParameter  : public juce::AudioParameterChoice
+{
+public:
+    using juce::AudioParameterChoice::AudioParameterChoice;
+
+    const std::atomic<bool>* liveModelLoaded = nullptr;
+
+private:
+    juce::String getText (float value, int maximumLength) const override
+    {
+        const int index = juce::roundToInt (convertFrom0to1 (value));
+        auto text = choices[index];
+
+        if (index == 1 && liveModelLoaded != nullptr && ! liveModelLoaded->load())
+            text << " (no model: Full)";
+
+        return text.substring (0, maximumLength);
+    }
+};
+
+#ifdef NATIVE_INFERENCE
+//==============================================================================
+// Reads model files and builds their networks for loadModelAsync(), and deletes the networks
+// the audio thread has finished with, so that neither file I/O nor allocation reaches it
+class MBDistProcessor::ModelLoader  : private juce::Thread
+{
+public:
+    using Callback = std::function<void (const juce::String&)>;
+
+    explicit ModelLoader (MBDistProcessor& p)
+        : juce::Thread ("Prism model loader"), processor (p)
+    {
+        startThread (juce::Thread::Priority::low);
+    }
+
+    ~ModelLoader() override
+    {
+        stopThread (10000);
+    }
+
+    void request (const juce::File& file, ModelTier tier, Callback onFinished)
+    {
+        {
+            const juce::ScopedLock sl (requestLock);
+            requests.push_back ({ file, tier, std::move (onFinished) });
+        }
+
+        notify();
+    }
+
+private:
+    struct Request
+    {
+        juce::File file;
+        ModelTier tier;
+        Callback onFinished;
+    };
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            processor.reclaimNetworks();
+            processor.prepareRequestedWeights();
+
+            std::vector<Request> pending;
+            {
+                const juce::ScopedLock sl (requestLock);
+                pending.swap (requests);
+            }
+
+            for (auto& r : pending)
+            {
+                juce::String error;
+                processor.installModel (r.file, r.tier, error);
+
+                if (r.onFinished == nullptr)
+                    continue;
+
+                if (juce::MessageManager::getInstanceWithoutCreating() != nullptr)
+                    juce::MessageManager::callAsync ([callback = std::move (r.onFinished), error] { callback (error); });
+                else
+                    r.onFinished (error);
+            }
+
+            // Retired networks and weight requests are served at this pace; the audio thread never wakes the loader
+            wait (100);
+        }
+    }
+
+    MBDistProcessor& processor;
+    juce::CriticalSection requestLock;
+    std::vector<Request> requests;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModelLoader)
+};
+#endif
+
 //==============================================================================
 MBDistProcessor::MBDistProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -23,54 +125,142 @@ MBDistProcessor::MBDistProcessor()
          apvts(*this, nullptr, "Parameters", createLayout())
 #endif
 {
+    bypassParam = apvts.getRawParameterValue ("Bypass");
+    oversamplingParam = apvts.getRawParameterValue ("Oversampling");
+    qualityParam = apvts.getRawParameterValue ("Quality");
+    tierParam = apvts.getRawParameterValue ("Tier");
+    tierParameter = dynamic_cast<TierParameter*> (apvts.getParameter ("Tier"));
+    cabinetParam = apvts.getRawParameterValue ("Cabinet");
+    for (int i = 0; i < NUM_BANDS; ++i)
+    {
+        bandEffectParams[i] = apvts.getRawParameterValue ("Band" + std::to_string (i + 1));
+        bandGainParams[i]   = apvts.getRawParameterValue ("Band" + std::to_string (i + 1) + "Gain");
+        bandToneParams[i]   = apvts.getRawParameterValue ("Band" + std::to_string (i + 1) + "Tone");
+
+        bandEffectParameters[i] = apvts.getParameter ("Band" + std::to_string (i + 1));
+        bandGainParameters[i]   = apvts.getParameter ("Band" + std::to_string (i + 1) + "Gain");
+        bandToneParameters[i]   = apvts.getParameter ("Band" + std::to_string (i + 1) + "Tone");
+    }
+
+    juce::String presetError;
+    const auto bankFile = PresetBank::getDefaultBankFile();
+    if (bankFile.existsAsFile() && ! presets.loadFromFile (bankFile, presetError))
+        DBG ("Preset bank not loaded: " << presetError);
+
+    // Presets hold values the parameters can represent, so that a program and its parameters agree exactly
+    for (int i = 0; i < presets.size(); ++i)
+    {
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            auto& settings = presets.getReference (i).bands[(size_t) band];
+            settings.gain = bandGainParameters[band]->convertFrom0to1 (bandGainParameters[band]->convertTo0to1 (settings.gain));
+            settings.tone = bandToneParameters[band]->convertFrom0to1 (bandToneParameters[band]->convertTo0to1 (settings.tone));
+        }
+    }
+
+#ifdef NATIVE_INFERENCE
+    // Without a model file the plugin falls back to the external (OSC) backend
+    juce::String modelError;
+    tiers[(size_t) ModelTier::full].model = PrismModel::loadShared (PrismModel::getDefaultModelFile(), modelError);
+    if (! hasModel())
+        DBG ("Native inference disabled: " << modelError);
+
+    // Optional: without it the Tier choice is disabled
+    tiers[(size_t) ModelTier::live].model = PrismModel::loadShared (PrismModel::getDefaultModelFile ("live"), modelError);
+    liveModelLoaded = tiers[(size_t) ModelTier::live].model != nullptr;
+
+    if (tierParameter != nullptr)
+        tierParameter->liveModelLoaded = &liveModelLoaded;
+
+    updateTailLength (getTierModel (getRequestedTier()).get());
+#endif
+
+#ifdef SHM_TRANSPORT
+   #ifdef NATIVE_INFERENCE
+    // The backend is only a fallback: with a native model there is nothing to share
+    if (! hasModel())
+   #endif
+        shmTransport = std::make_unique<ShmTransport> (shmName, ShmTransport::Role::plugin);
+#endif
+
 #ifdef OSC
     oscSender = std::make_unique<juce::OSCSender>();
     oscSender->connect(oscIP, oscPortOut);
 
-    for (auto& param : this->getParameters())
+   #ifdef SHM_TRANSPORT
+    // Tells the backend which region belongs to this instance
+    if (shmTransport != nullptr && shmTransport->isOpen())
+        oscSender->send ("/transport", shmName);
+   #endif
+
+    // Indexed like getParameters(), so that a change is published by the parameter's own index
+    juce::StringArray parameterIDs;
+    for (auto* param : getParameters())
     {
-        // try static cast to AudioParameterWithID
-        try {
-            juce::AudioProcessorParameterWithID* p = dynamic_cast<juce::AudioProcessorParameterWithID*>(param);
-            if (p != nullptr)
-            {
-                apvts.addParameterListener (p->getParameterID(), this);
-            }
-        } catch (...) {
-            // do nothing
-        }
+        auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param);
+        parameterIDs.add (p != nullptr ? p->getParameterID() : juce::String());
     }
+
+    oscPublisher = std::make_unique<OscPublisher> (*oscSender, parameterIDs);
+
+    for (auto* param : getParameters())
+        param->addListener (this);
+
+   #ifdef RT_INSTRUMENTATION
+    oscPublisher->setStatusProvider ([this]
+    {
+        const auto status = instrumentation.getSnapshot();
+
+        juce::OSCMessage msg ("/status");
+        msg.addInt32 ((juce::int32) status.blocks);
+        msg.addInt32 ((juce::int32) status.overruns);
+        msg.addInt32 ((juce::int32) status.nearMisses);
+        msg.addInt32 ((juce::int32) status.allocations);
+        msg.addInt32 ((juce::int32) status.lockAcquisitions);
+        msg.addFloat32 (status.meanLoad);
+        msg.addFloat32 (status.peakLoad);
+        return msg;
+    });
+   #endif
 #endif
 }
 
 MBDistProcessor::~MBDistProcessor()
 {
-    
-    for (auto& param : this->getParameters())
+#ifdef OSC
+    for (auto* param : getParameters())
+        param->removeListener (this);
+
+    // Stop the publisher thread before the members its status provider reads go away
+    oscPublisher = nullptr;
+#endif
+
+#ifdef NATIVE_INFERENCE
+    // Networks in transit are owned by whoever takes them from the slot: here, nobody else is left
+    modelLoader = nullptr;
+
+    for (auto& tier : tiers)
     {
-        // try static cast to AudioParameterWithID
-        try {
-            juce::AudioProcessorParameterWithID* p = dynamic_cast<juce::AudioProcessorParameterWithID*>(param);
-            if (p != nullptr)
-            {
-                apvts.removeParameterListener (p->getParameterID(), this);
-            }
-        } catch (...) {
-            // do nothing
-        }
+        delete tier.incoming.exchange (nullptr);
+        delete tier.retired.exchange (nullptr);
     }
+#endif
 }
 
 #ifdef OSC
-void MBDistProcessor::parameterChanged (const String& parameterID, float newValue) {
-    juce::OSCMessage msg("/parameterChanged");
-    msg.addString(parameterID);
-    msg.addFloat32(newValue);
-    oscSender->send(msg);
+void MBDistProcessor::parameterValueChanged (int parameterIndex, float newValue)
+{
+    // May be called on the audio thread: only queue the value, the publisher thread sends it.
+    // Every parameter comes from the APVTS layout, and the backend expects plain values
+    auto* param = static_cast<juce::RangedAudioParameter*> (getParameters().getUnchecked (parameterIndex));
+    oscPublisher->publish (parameterIndex, param->convertFrom0to1 (newValue));
 }
 #endif
 
 const juce::StringArray MBDistProcessor::bandEffects = { "Distortion", "Fuzz", "Overdrive" };
+const juce::StringArray MBDistProcessor::oversamplingFactors = { "1x", "2x", "4x", "8x" };
+const juce::StringArray MBDistProcessor::qualityModes = { "Full (fp32)", "Half (fp16)", "Eco (int8)" };
+const juce::StringArray MBDistProcessor::modelTiers = { "Full", "Live" };
 
 // Create layout function
 juce::AudioProcessorValueTreeState::ParameterLayout MBDistProcessor::createLayout()
@@ -111,6 +301,37 @@ juce::AudioProcessorValueTreeState::ParameterLayout MBDistProcessor::createLayou
         ));
     }
 
+    // Oversampling around the band split and the networks
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "Oversampling",
+        "Oversampling",
+        oversamplingFactors,
+        0
+    ));
+
+    // Arithmetic precision of the networks (see TCNKernels)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        "Quality",
+        "Quality",
+        qualityModes,
+        0
+    ));
+
+    // Network variant: the full one for mixing, or the lighter, lower-latency one for tracking
+    params.push_back(std::make_unique<TierParameter>(
+        "Tier",
+        "Model Tier",
+        modelTiers,
+        0
+    ));
+
+    // Cabinet impulse response after the band sum (see CabinetStage), off until an IR is loaded
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        "Cabinet",
+        "Cabinet",
+        false
+    ));
+
     return { params.begin(), params.end() };
 }
 
@@ -149,53 +370,204 @@ bool MBDistProcessor::isMidiEffect() const
 
 double MBDistProcessor::getTailLengthSeconds() const
 {
+    // Hosts ask from any thread, also while the loader holds loaderLock for a whole network build
+#ifdef NATIVE_INFERENCE
+    return tailSeconds.load (std::memory_order_relaxed);
+#else
     return 0.0;
+#endif
 }
 
 int MBDistProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presets.size();  // never 0: a bank always holds at least one preset
 }
 
 int MBDistProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
-void MBDistProcessor::setCurrentProgram (int /*index*/)
+void MBDistProcessor::setCurrentProgram (int index)
 {
+    if (! juce::isPositiveAndBelow (index, presets.size()))
+        return;
+
+    currentProgram = index;
+
+#ifdef NATIVE_INFERENCE
+    // The networks switch at the start of the next block, from the precomputed snapshot...
+    pendingProgram.store (index);
+#endif
+
+    // ...while the parameters follow here, for the host, the editor and the saved state
+    const auto& preset = presets[index];
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        const auto& settings = preset.bands[(size_t) band];
+
+        bandEffectParameters[band]->setValueNotifyingHost (bandEffectParameters[band]->convertTo0to1 ((float) settings.effect));
+        bandGainParameters[band]->setValueNotifyingHost (bandGainParameters[band]->convertTo0to1 (settings.gain));
+        bandToneParameters[band]->setValueNotifyingHost (bandToneParameters[band]->convertTo0to1 (settings.tone));
+    }
 }
 
-const juce::String MBDistProcessor::getProgramName (int /*index*/)
+const juce::String MBDistProcessor::getProgramName (int index)
 {
-    return {};
+    return juce::isPositiveAndBelow (index, presets.size()) ? presets[index].name : juce::String();
 }
 
-void MBDistProcessor::changeProgramName (int /*index*/, const juce::String& /*newName*/)
+void MBDistProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    if (juce::isPositiveAndBelow (index, presets.size()))
+        presets.getReference (index).name = newName;
 }
 
 //==============================================================================
-void MBDistProcessor::prepareToPlay (double /*sampleRate*/, int /*samplesPerBlock*/)
+void MBDistProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-    for (auto& param : this->getParameters())
+#ifdef RT_INSTRUMENTATION
+    instrumentation.prepare (sampleRate);
+#endif
+
+#ifdef NATIVE_INFERENCE
+   #ifdef BATCHED_INFERENCE
+    // The worker may still be running the last frame on the engines about to be rebuilt
+    if (batchClient != nullptr)
+        batchClient->cancel();
+   #endif
+
+    const juce::ScopedLock sl (loaderLock);
+
+    currentSampleRate = sampleRate;
+
+    // Whatever was in transit was built for the old settings
+    for (auto& tier : tiers)
+    {
+        tier.network = nullptr;
+        tier.retiring = nullptr;
+        delete tier.incoming.exchange (nullptr);
+        delete tier.retired.exchange (nullptr);
+    }
+
+    if (tiers[0].model != nullptr)
     {
-        // try static cast to AudioParameterWithID
-        try {
-            juce::AudioProcessorParameterWithID* p = dynamic_cast<juce::AudioProcessorParameterWithID*>(param);
-            if (p != nullptr)
+        const int numChannels = getTotalNumOutputChannels();
+        const int maxFactor = 1 << maxOversamplingOrder;
+
+        preparedNumChannels = numChannels;
+        preparedBlockSize = samplesPerBlock;
+
+        // Both tiers are prepared, so that switching between them is allocation-free
+        for (int t = 0; t < numModelTiers; ++t)
+        {
+            auto& tier = tiers[(size_t) t];
+
+            // Linear-phase oversampling for the full tier, minimum-phase (far less latency) for the live one
+            const auto filterType = t == (int) ModelTier::live ? juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR
+                                                               : juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple;
+
+            // Everything for every oversampling factor is allocated here, switching is allocation-free
+            for (int order = 0; order <= maxOversamplingOrder; ++order)
             {
-                // void MBDistProcessor::parameterChanged (const String& parameterID, float newValue) {
-                auto value = apvts.getRawParameterValue(p->getParameterID());
-                parameterChanged(p->getParameterID(), value->load());
+                tier.crossovers[(size_t) order].prepare (sampleRate * (1 << order), numChannels, samplesPerBlock << order);
+
+                if (order > 0)
+                {
+                    // Integer latency (a fractional delay is added) so that the reported latency is exact
+                    tier.oversamplers[(size_t) order] = std::make_unique<juce::dsp::Oversampling<float>> (
+                        (size_t) numChannels, (size_t) order, filterType, true, true);
+                    tier.oversamplers[(size_t) order]->setUsingIntegerLatency (true);
+                    tier.oversamplers[(size_t) order]->initProcessing ((size_t) samplesPerBlock);
+                }
             }
-        } catch (...) {
-            // do nothing
+
+            tier.network = createNetwork (getTierModel (t));
         }
+
+        if (getDilationScale (*getTierModel (currentTier), sampleRate, (int) oversamplingParam->load()) == 0)
+            DBG ("The model (" << getTierModel (currentTier)->getSampleRate() << " Hz) cannot run at "
+                 << sampleRate << " Hz with this oversampling factor: the input is passed through");
+
+        heldProgram = -1;
+
+        // Also builds reduced weights when the Quality parameter asks for them
+        if (modelLoader == nullptr)
+            modelLoader = std::make_unique<ModelLoader> (*this);
+
+        // Every (channel, band) stream has its own buffer, so bands can be processed concurrently
+        bandBuffer.setSize (2 * numChannels * NUM_BANDS, samplesPerBlock * maxFactor);
+        maxChunkSize = samplesPerBlock;
+
+        currentTier = getRequestedTier();
+        activeTier.store (currentTier, std::memory_order_relaxed);
+        updateTailLength (tiers[(size_t) currentTier].network->model.get());
+        previousTier = -1;
+        tierFadeLength = juce::jmax (1, (int) (tierFadeSeconds * sampleRate));
+
+       #ifdef BATCHED_INFERENCE
+        if (batchClient == nullptr)
+            batchClient = std::make_unique<InferenceScheduler::Client> (*scheduler);
+
+        // Streams [tier][network, retiring network][channel][band]: the streams of a network that
+        // is not running are skipped
+        batchClient->prepare (std::vector<TCNEngine*> ((size_t) (numModelTiers * 2 * numChannels * NUM_BANDS)),
+                              samplesPerBlock * maxFactor, samplesPerBlock / sampleRate);
+        batchInput.setSize (numChannels, samplesPerBlock);
+        batchFrame.setSize (numModelTiers * numChannels, samplesPerBlock);
+        batchOutput.setSize (numChannels, 2 * samplesPerBlock);
+        batchOutput.clear();
+
+        // The output FIFO starts one frame ahead: that frame is the added latency
+        batchInputFill = 0;
+        batchOutputFill = samplesPerBlock;
+        batchFrameState = FrameState::none;
+       #else
+        tierFadeBuffer.setSize (numChannels, samplesPerBlock);
+
+        // Helpers for the band tasks; the audio thread takes a share itself. Offline, renders
+        // already run side by side (PrismRender runs one per core) and get no helpers
+        if (! isNonRealtime())
+            bandWorkers->prepare (numChannels * NUM_BANDS - 1);
+       #endif
+
+        setOversamplingOrder ((int) oversamplingParam->load());
+
+        // The bypass delay covers the longest latency any tier and factor can report
+        maxBypassDelay = 0;
+
+        for (auto& tier : tiers)
+            for (auto& oversampler : tier.oversamplers)
+                if (oversampler != nullptr)
+                    maxBypassDelay = juce::jmax (maxBypassDelay, juce::roundToInt (oversampler->getLatencyInSamples()));
+
+       #ifdef BATCHED_INFERENCE
+        maxBypassDelay += samplesPerBlock;
+       #endif
+
+        bypassDelay.prepare ({ sampleRate, (juce::uint32) samplesPerBlock, (juce::uint32) numChannels });
+        bypassDelay.setMaximumDelayInSamples (juce::jmax (1, maxBypassDelay));
+        bypassDryBuffer.setSize (numChannels, samplesPerBlock);
+        bypassMix.reset (sampleRate, bypassFadeSeconds);
+        bypassMix.setCurrentAndTargetValue (bypassParam->load() >= 0.5f || tiers[(size_t) currentTier].network->dilationScale == 0 ? 1.0f : 0.0f);
+
+        cabinet.prepare (sampleRate, numChannels, samplesPerBlock);
+    }
+    else
+    {
+        preparedNumChannels = 0;
     }
+#else
+    juce::ignoreUnused (sampleRate, samplesPerBlock);
+#endif
+
+#ifdef OSC
+    // Use this method as the place to do any pre-playback
+    // initialisation that you need..
+    for (auto* param : getParameters())
+        parameterValueChanged (param->getParameterIndex(), param->getValue());
+#endif
 }
 
 void MBDistProcessor::releaseResources()
@@ -211,12 +583,11 @@ bool MBDistProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Channels are processed independently, so any layout (mono, stereo, surround or
+    // discrete) works, up to maxNumChannels
+    const auto& outputs = layouts.getMainOutputChannelSet();
+
+    if (outputs.isDisabled() || outputs.size() > maxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -230,38 +601,1126 @@ bool MBDistProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 }
 #endif
 
-void MBDistProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& /*midiMessages*/)
+void MBDistProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+#ifdef NATIVE_INFERENCE
+    // Hosts may exceed the block size they announced: the buffers below are sized for it
+    if (preparedBlockSize > 0 && buffer.getNumSamples() > preparedBlockSize)
+    {
+        for (int start = 0; start < buffer.getNumSamples(); start += preparedBlockSize)
+        {
+            juce::AudioBuffer<float> part (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                           start, juce::jmin (preparedBlockSize, buffer.getNumSamples() - start));
+            processBlock (part, midiMessages);
+        }
+
+        return;
+    }
+#else
+    juce::ignoreUnused (midiMessages);
+#endif
+
     juce::ScopedNoDenormals noDenormals;
+#ifdef RT_INSTRUMENTATION
+    RtInstrumentation::BlockScope instrumentationScope (instrumentation, buffer.getNumSamples());
+#endif
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+
+#ifdef NATIVE_INFERENCE
+    if (tiers[(size_t) currentTier].network == nullptr)
+    {
+       #ifdef SHM_TRANSPORT
+        if (shmTransport != nullptr && shmTransport->isBackendAttached())
+        {
+            exchangeWithBackend (buffer);
+            return;
+        }
+       #endif
+        buffer.clear(); // Audio is processed by the external backend
+        return;
+    }
+
+    // Bypassed audio is delayed like processed audio, so that toggling keeps the track in place
+    const int numOutputChannels = juce::jmin (buffer.getNumChannels(), preparedNumChannels);
+    delayDryInput (buffer, numOutputChannels);
+    // A network that cannot run at this rate (see getDilationScale()) passes the input through as well
+    const bool bypassed = bypassParam->load() >= 0.5f || tiers[(size_t) currentTier].network->dilationScale == 0;
+    bypassMix.setTargetValue (bypassed ? 1.0f : 0.0f);
+
+    if (! bypassMix.isSmoothing() && bypassMix.getTargetValue() == 1.0f)
+    {
+        for (int ch = 0; ch < numOutputChannels; ++ch)
+            buffer.copyFrom (ch, 0, bypassDryBuffer, ch, 0, buffer.getNumSamples());
+
+        return;
+    }
+
+   #ifdef BATCHED_INFERENCE
+    processBatched (buffer, juce::jmin (buffer.getNumChannels(), preparedNumChannels));
+   #else
+    const int order = juce::jlimit (0, maxOversamplingOrder, (int) oversamplingParam->load());
+    if (order != oversamplingOrder)
+        setOversamplingOrder (order);
+
+    updatePrecision();
+    updateTier();
+    updateNetworks();
+    applyPendingProgram (buffer.getNumSamples());
+    updateConditioning (buffer.getNumSamples() << oversamplingOrder);
+
+    const int numChannels = juce::jmin (buffer.getNumChannels(), preparedNumChannels);
+    juce::dsp::AudioBlock<float> block = juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (0, (size_t) numChannels);
+
+    for (int start = 0; start < buffer.getNumSamples(); start += maxChunkSize)
+    {
+        const int numSamples = juce::jmin (maxChunkSize, buffer.getNumSamples() - start);
+        auto chunk = block.getSubBlock ((size_t) start, (size_t) numSamples);
+
+        if (previousTier >= 0)
+        {
+            auto previous = juce::dsp::AudioBlock<float> (tierFadeBuffer).getSubsetChannelBlock (0, (size_t) numChannels)
+                                                                         .getSubBlock (0, (size_t) numSamples);
+            previous.copyFrom (chunk);
+
+            processTierChunk (previousTier, previous);
+            processTierChunk (currentTier, chunk);
+            mixTierSwitch (chunk, previous);
+        }
+        else
+        {
+            processTierChunk (currentTier, chunk);
+        }
+    }
+   #endif
+
+    // After the band sum, at the host rate
+    cabinet.setEnabled (cabinetParam->load() >= 0.5f);
+    cabinet.process (juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (0, (size_t) numOutputChannels));
+
+    if (bypassMix.isSmoothing())
+    {
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const float gain = bypassMix.getNextValue();
+
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+            {
+                float* out = buffer.getWritePointer (ch);
+                out[i] += gain * (bypassDryBuffer.getSample (ch, i) - out[i]);
+            }
+        }
+    }
+#else
+   #ifdef SHM_TRANSPORT
+    if (shmTransport != nullptr && shmTransport->isBackendAttached())
+    {
+        exchangeWithBackend (buffer);
+        return;
+    }
+   #endif
     buffer.clear();
+#endif
 }
 
-//==============================================================================
-bool MBDistProcessor::hasEditor() const
+#ifdef SHM_TRANSPORT
+void MBDistProcessor::exchangeWithBackend (juce::AudioBuffer<float>& buffer)
 {
-    return true; // (change this to false if you choose to not supply an editor)
+    auto& outgoing = shmTransport->getOutgoing();
+    auto& incoming = shmTransport->getIncoming();
+
+    const int numChannels = juce::jmin (buffer.getNumChannels(), ShmTransport::maxChannels);
+    const double ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+
+    for (int start = 0; start < buffer.getNumSamples(); start += ShmTransport::maxSamples)
+    {
+        const int numSamples = juce::jmin (ShmTransport::maxSamples, buffer.getNumSamples() - start);
+
+        auto* frame = outgoing.beginWrite();
+        if (frame == nullptr)
+        {
+            ++shmMissedBlocks;
+            buffer.clear (start, numSamples);
+            continue;
+        }
+
+        const auto sequence = ++shmSequence;
+        frame->sequence = sequence;
+        frame->numChannels = (juce::uint32) numChannels;
+        frame->numSamples = (juce::uint32) numSamples;
+        frame->numParameters = 1 + 3 * NUM_BANDS;
+        frame->parameters[0] = bypassParam->load();
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            frame->parameters[1 + 3 * band]     = bandEffectParams[band]->load();
+            frame->parameters[1 + 3 * band + 1] = bandGainParams[band]->load();
+            frame->parameters[1 + 3 * band + 2] = bandToneParams[band]->load();
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::copy (frame->audio[ch], buffer.getReadPointer (ch, start), numSamples);
+
+        outgoing.finishWrite();
+
+        // Wait for the reply for at most half of the chunk duration, without leaving user space
+        const auto deadline = juce::Time::getHighResolutionTicks()
+                            + (juce::int64) (0.5 * numSamples / getSampleRate() * ticksPerSecond);
+        bool received = false;
+
+        while (! received && juce::Time::getHighResolutionTicks() < deadline)
+        {
+            auto* reply = incoming.beginRead();
+
+            if (reply == nullptr)
+            {
+                ShmTransport::cpuRelax();
+                continue;
+            }
+
+            // Replies to chunks we already gave up on are dropped
+            if (reply->sequence == sequence)
+            {
+                for (int ch = 0; ch < juce::jmin (numChannels, (int) reply->numChannels); ++ch)
+                    juce::FloatVectorOperations::copy (buffer.getWritePointer (ch, start), reply->audio[ch], numSamples);
+
+                received = true;
+            }
+
+            incoming.finishRead();
+        }
+
+        if (! received)
+        {
+            ++shmMissedBlocks;
+            buffer.clear (start, numSamples);
+        }
+    }
 }
+#endif
 
-juce::AudioProcessorEditor* MBDistProcessor::createEditor()
+#ifdef NATIVE_INFERENCE
+bool MBDistProcessor::loadModel (const juce::File& file, juce::String& errorMessage, ModelTier tier)
 {
-    return new MBDistEditor (*this);
+    auto newModel = PrismModel::loadShared (file, errorMessage);
+
+    if (newModel == nullptr)
+        return false;
+
+   #ifdef BATCHED_INFERENCE
+    if (batchClient != nullptr)
+        batchClient->cancel();
+   #endif
+
+    const juce::ScopedLock sl (loaderLock);
+
+    // The live tier may run the full tier's network: drop them all, prepareToPlay() rebuilds them
+    for (auto& t : tiers)
+    {
+        t.network = nullptr;
+        t.retiring = nullptr;
+        delete t.incoming.exchange (nullptr);
+    }
+
+    tiers[(size_t) tier].model = std::move (newModel);
+    liveModelLoaded = tiers[(size_t) ModelTier::live].model != nullptr;
+    updateTailLength (getTierModel (getRequestedTier()).get());
+    return true;
 }
 
-//==============================================================================
-void MBDistProcessor::getStateInformation (juce::MemoryBlock& destData)
+void MBDistProcessor::loadModelAsync (const juce::File& file, ModelTier tier,
+                                      std::function<void (const juce::String&)> onFinished)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    if (modelLoader == nullptr)
+        modelLoader = std::make_unique<ModelLoader> (*this);
+
+    modelLoader->request (file, tier, std::move (onFinished));
 }
 
-void MBDistProcessor::setStateInformation (const void* data, int sizeInBytes)
+void MBDistProcessor::loadCabinetImpulseResponse (const juce::File& file)
+{
+    if (file == juce::File())
+        cabinet.clearImpulseResponse();
+    else
+        cabinet.loadImpulseResponse (file);
+}
+
+juce::File MBDistProcessor::getCabinetImpulseResponse() const
+{
+    return cabinet.getImpulseResponseFile();
+}
+
+void MBDistProcessor::updateTailLength (const PrismModel* model) noexcept
+{
+    tailSeconds.store (model != nullptr ? model->getReceptiveField() / model->getSampleRate() : 0.0,
+                       std::memory_order_relaxed);
+}
+
+bool MBDistProcessor::hasModel() const
+{
+    const juce::ScopedLock sl (loaderLock);
+    return tiers[0].model != nullptr;
+}
+
+std::shared_ptr<const PrismModel> MBDistProcessor::getTierModel (int tier) const
+{
+    const auto& model = tiers[(size_t) tier].model;
+    return model != nullptr ? model : tiers[(size_t) ModelTier::full].model;
+}
+
+int MBDistProcessor::getDilationScale (const PrismModel& model, double hostRate, int order) noexcept
+{
+    const double ratio = hostRate * (1 << juce::jlimit (0, maxOversamplingOrder, order)) / model.getSampleRate();
+    const int scale = juce::roundToInt (ratio);
+
+    // Rates are nominal: allow for a host reporting e.g. 47999.9 Hz
+    return scale >= 1 && std::abs (ratio - scale) <= 1.0e-3 * ratio ? scale : 0;
+}
+
+std::unique_ptr<MBDistProcessor::Network> MBDistProcessor::createNetwork (std::shared_ptr<const PrismModel> model) const
+{
+    const int maxFactor = 1 << maxOversamplingOrder;
+    auto network = std::make_unique<Network>();
+
+    // History for the largest dilation spread any oversampling factor may need
+    int maxScale = 1;
+    for (int order = 0; order <= maxOversamplingOrder; ++order)
+        maxScale = juce::jmax (maxScale, getDilationScale (*model, currentSampleRate, order));
+
+    network->engines.resize ((size_t) (preparedNumChannels * NUM_BANDS));
+    for (auto& engine : network->engines)
+        engine.prepare (*model, preparedBlockSize * maxFactor, maxScale);
+
+    // The fp16/int8 weights are only built for models that are going to use them
+    if ((int) qualityParam->load() != (int) TCNEngine::Precision::fp32)
+        model->prepareReducedWeights();
+
+    network->conditioning.prepare (*model);
+    network->bandGate.prepare ((int) network->engines.size());
+
+    network->programSnapshots.resize ((size_t) presets.size());
+    for (int i = 0; i < presets.size(); ++i)
+        network->conditioning.makeSnapshot (presets[i].bands, network->programSnapshots[(size_t) i]);
+
+    network->model = std::move (model);
+    return network;
+}
+
+bool MBDistProcessor::installModel (const juce::File& file, ModelTier tier, juce::String& errorMessage)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // Parsing the file needs no lock: loadShared() is thread-safe. Files swapped in at runtime
+    // are often rewritten in place by a training run, so they are copied rather than mapped
+    auto newModel = PrismModel::loadShared (file, errorMessage, PrismModel::Storage::copied);
+
+    if (newModel == nullptr)
+        return false;
+
+    const juce::ScopedLock sl (loaderLock);
+
+    tiers[(size_t) tier].model = std::move (newModel);
+    liveModelLoaded = tiers[(size_t) ModelTier::live].model != nullptr;
+
+    // Not prepared yet: prepareToPlay() builds the networks from the new model
+    if (preparedNumChannels == 0)
+        return true;
+
+    for (int t = 0; t < numModelTiers; ++t)
+    {
+        // A live tier without a network of its own follows the full one
+        if (t != (int) tier && ! (tier == ModelTier::full && tiers[(size_t) t].model == nullptr))
+            continue;
+
+        // An incoming network the audio thread has not taken yet is superseded
+        delete tiers[(size_t) t].incoming.exchange (createNetwork (getTierModel (t)).release());
+    }
+
+    return true;
+}
+
+void MBDistProcessor::reclaimNetworks()
+{
+    for (auto& tier : tiers)
+        delete tier.retired.exchange (nullptr);
+}
+
+void MBDistProcessor::prepareRequestedWeights()
+{
+    if (! reducedWeightsRequested.exchange (false))
+        return;
+
+    const juce::ScopedLock sl (loaderLock);
+
+    for (int t = 0; t < numModelTiers; ++t)
+        if (auto model = getTierModel (t))
+            model->prepareReducedWeights();
+}
+
+bool MBDistProcessor::updateNetworks()
+{
+    bool changed = false;
+
+    for (int t = 0; t < numModelTiers; ++t)
+    {
+        auto& tier = tiers[(size_t) t];
+
+        // Swaps end once the old network is no longer heard, or with the tier going quiet
+        if (tier.retiring != nullptr && (! isTierRunning (t) || tier.swapElapsed >= tier.swapWarmUp + (tierFadeLength << oversamplingOrder)))
+        {
+            endNetworkSwap (tier);
+            changed = true;
+        }
+
+        // One swap at a time, and only once the loader has collected the last retired network,
+        // so that the retired slot is always free when a swap ends
+        if (tier.retiring != nullptr || tier.retired.load (std::memory_order_acquire) != nullptr)
+            continue;
+
+        auto* incoming = tier.incoming.exchange (nullptr, std::memory_order_acq_rel);
+
+        if (incoming == nullptr)
+            continue;
+
+        tier.retiring = std::move (tier.network);
+        tier.network.reset (incoming);
+        configureNetwork (*tier.network);
+        changed = true;
+
+        // The new network runs unheard until it has a history, then the tier crossfades to it
+        tier.swapElapsed = 0;
+        tier.swapWarmUp = tier.network->model->getReceptiveField() * juce::jmax (1, tier.network->dilationScale);
+
+        // A tier nobody hears starts its next run from silence anyway (see updateTier())
+        if (! isTierRunning (t))
+            endNetworkSwap (tier);
+    }
+
+    if (changed)
+        updateTailLength (tiers[(size_t) currentTier].network->model.get());
+
+   #ifdef BATCHED_INFERENCE
+    if (changed)
+        bindBatchStreams();
+   #endif
+
+    return changed;
+}
+
+void MBDistProcessor::configureNetwork (Network& network) noexcept
+{
+    // The networks keep their trained time spans by spreading their dilations
+    network.dilationScale = getDilationScale (*network.model, currentSampleRate, oversamplingOrder);
+
+    if (network.dilationScale == 0)
+        return;
+
+    for (auto& engine : network.engines)
+    {
+        engine.setDilationScale (network.dilationScale);
+        engine.setPrecision (precision);
+    }
+
+    // The engines were reset: every band starts open and must stay quiet for a receptive field to close
+    network.bandGate.reset();
+    network.bandGate.setHoldTime (network.model->getReceptiveField() * network.dilationScale);
+    network.bandGate.setFadeTime ((int) (0.002 * currentSampleRate) << oversamplingOrder);
+}
+
+void MBDistProcessor::endNetworkSwap (Tier& tier) noexcept
+{
+    // updateNetworks() only starts a swap with the slot empty, and only the loader empties it
+    jassert (tier.retired.load() == nullptr);
+    tier.retired.store (tier.retiring.release(), std::memory_order_release);
+}
+
+void MBDistProcessor::setOversamplingOrder (int order)
+{
+    oversamplingOrder = juce::jlimit (0, maxOversamplingOrder, order);
+
+    for (auto& tier : tiers)
+    {
+        // Networks start again from silence: a swap under way is over
+        if (tier.retiring != nullptr)
+            endNetworkSwap (tier);
+
+        if (tier.network != nullptr)
+            configureNetwork (*tier.network);
+
+        tier.crossovers[(size_t) oversamplingOrder].reset();
+
+        if (auto* oversampler = tier.oversamplers[(size_t) oversamplingOrder].get())
+            oversampler->reset();
+    }
+
+   #ifdef BATCHED_INFERENCE
+    bindBatchStreams();
+   #endif
+
+    // Both tiers start again from silence: a switch under way is over
+    previousTier = -1;
+    updateLatency();
+}
+
+void MBDistProcessor::updateLatency()
+{
+    auto* oversampler = tiers[(size_t) currentTier].oversamplers[(size_t) oversamplingOrder].get();
+    int latency = oversampler != nullptr ? juce::roundToInt (oversampler->getLatencyInSamples()) : 0;
+
+   #ifdef BATCHED_INFERENCE
+    latency += maxChunkSize;
+   #endif
+
+    setLatencySamples (latency);
+}
+
+void MBDistProcessor::delayDryInput (const juce::AudioBuffer<float>& buffer, int numChannels) noexcept
+{
+    // Fed every block, bypassed or not, so that the delayed signal is there when bypass is switched on
+    bypassDelay.setDelay ((float) juce::jmin (getLatencySamples(), maxBypassDelay));
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* in = buffer.getReadPointer (ch);
+        float* dry = bypassDryBuffer.getWritePointer (ch);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            bypassDelay.pushSample (ch, in[i]);
+            dry[i] = bypassDelay.popSample (ch);
+        }
+    }
+}
+
+int MBDistProcessor::getRequestedTier() const noexcept
+{
+    // Without a network of its own the live tier would run the full one: the same output at 1x,
+    // and only other oversampling filters above
+    if (! hasLiveModel())
+        return (int) ModelTier::full;
+
+    return juce::jlimit (0, numModelTiers - 1, (int) tierParam->load());
+}
+
+void MBDistProcessor::updateTier()
+{
+    const int tier = getRequestedTier();
+
+    // A switch under way completes first, a newer request is picked up after it
+    if (tier == currentTier || previousTier >= 0)
+        return;
+
+    // The incoming tier has been idle since it was last heard: restart it from silence
+    auto& incoming = tiers[(size_t) tier];
+
+    for (auto& engine : incoming.network->engines)
+        engine.reset();
+
+    incoming.crossovers[(size_t) oversamplingOrder].reset();
+    incoming.network->bandGate.reset();
+
+    if (auto* oversampler = incoming.oversamplers[(size_t) oversamplingOrder].get())
+        oversampler->reset();
+
+    previousTier = currentTier;
+    currentTier = tier;
+    activeTier.store (tier, std::memory_order_relaxed);
+    updateTailLength (incoming.network->model.get());
+    tierSwitchElapsed = 0;
+    // The receptive field at the host rate
+    const int factor = 1 << oversamplingOrder;
+    tierSwitchWarmUp = (incoming.network->model->getReceptiveField() * juce::jmax (1, incoming.network->dilationScale) + factor - 1) / factor;
+}
+
+void MBDistProcessor::mixTierSwitch (juce::dsp::AudioBlock<float> output, const juce::dsp::AudioBlock<float>& previous)
+{
+    // The previous tier alone during the warm-up, then a linear crossfade to the current one
+    const int numSamples = (int) output.getNumSamples();
+    const float step = 1.0f / (float) tierFadeLength;
+
+    for (size_t ch = 0; ch < output.getNumChannels(); ++ch)
+    {
+        float* out = output.getChannelPointer (ch);
+        const float* old = previous.getChannelPointer (ch);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float gain = juce::jlimit (0.0f, 1.0f, (float) (tierSwitchElapsed + i - tierSwitchWarmUp + 1) * step);
+            out[i] = old[i] + gain * (out[i] - old[i]);
+        }
+    }
+
+    tierSwitchElapsed += numSamples;
+
+    // Only now is the output the current tier's alone, at its latency
+    if (tierSwitchElapsed >= tierSwitchWarmUp + tierFadeLength)
+    {
+        previousTier = -1;
+        updateLatency();
+    }
+}
+
+void MBDistProcessor::processTierChunk (int t, juce::dsp::AudioBlock<float> chunk)
+{
+    auto& tier = tiers[(size_t) t];
+
+    if (tier.network->dilationScale == 0)
+        return;
+    auto* oversampler = tier.oversamplers[(size_t) oversamplingOrder].get();
+
+    auto upsampled = oversampler != nullptr ? oversampler->processSamplesUp (chunk) : chunk;
+    const int numUpsampled = (int) upsampled.getNumSamples();
+    const int numChannels = (int) chunk.getNumChannels();
+    const bool swapping = tier.retiring != nullptr;
+
+    auto* const* bands = bandBuffer.getArrayOfWritePointers();
+    auto* const* retiringBands = bands + preparedNumChannels * NUM_BANDS;
+
+    // The band split is cheap next to the networks: it runs here, before the bands are shared out
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        tier.crossovers[(size_t) oversamplingOrder].process (ch, upsampled.getChannelPointer ((size_t) ch),
+                                                             bands + ch * NUM_BANDS, numUpsampled);
+
+        // During a swap the old network runs on a copy of the same bands
+        if (swapping)
+            for (int band = 0; band < NUM_BANDS; ++band)
+                juce::FloatVectorOperations::copy (retiringBands[ch * NUM_BANDS + band], bands[ch * NUM_BANDS + band], numUpsampled);
+    }
+
+    // One task per (network, channel, band): each touches only its own band buffer, gate stream
+    // and engine, so the tasks can run on the workers in any order
+    const int streamsPerNetwork = numChannels * NUM_BANDS;
+
+    auto bandTask = [&] (int task)
+    {
+       #ifdef RT_INSTRUMENTATION
+        // On a helper, the task's allocations and locks still count towards this block
+        const RtInstrumentation::TaskScope instrumentationScope (instrumentation);
+       #endif
+
+        if (task < streamsPerNetwork)
+            processBand (*tier.network, task, bands[task], numUpsampled);
+        else
+            processBand (*tier.retiring, task - streamsPerNetwork, retiringBands[task - streamsPerNetwork], numUpsampled);
+    };
+
+    const int numTasks = swapping ? 2 * streamsPerNetwork : streamsPerNetwork;
+
+    if (numUpsampled >= minParallelChunkSize && ! isNonRealtime())
+    {
+        bandWorkers->run (numTasks, bandTask);
+    }
+    else
+    {
+        for (int task = 0; task < numTasks; ++task)
+            bandTask (task);
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* const* channelBands = bands + ch * NUM_BANDS;
+        float* data = upsampled.getChannelPointer ((size_t) ch);
+
+        if (swapping)
+            mixNetworkSwap (tier, channelBands, retiringBands + ch * NUM_BANDS, tier.swapElapsed, numUpsampled);
+
+        juce::FloatVectorOperations::copy (data, channelBands[0], numUpsampled);
+        for (int band = 1; band < NUM_BANDS; ++band)
+            juce::FloatVectorOperations::add (data, channelBands[band], numUpsampled);
+    }
+
+    tier.network->conditioning.advance (numUpsampled);
+
+    if (swapping)
+    {
+        tier.retiring->conditioning.advance (numUpsampled);
+        tier.swapElapsed += numUpsampled;
+    }
+
+    if (oversampler != nullptr)
+        oversampler->processSamplesDown (chunk);
+}
+
+void MBDistProcessor::processBand (Network& network, int stream, float* data, int numSamples) noexcept
+{
+    const int band = stream % NUM_BANDS;
+    const auto action = network.bandGate.update (stream, data, numSamples);
+    auto& engine = network.engines[(size_t) stream];
+
+    if (action == BandGate::Action::fadeIn)
+        engine.settle (network.conditioning.getFiLM (band));
+
+    if (action != BandGate::Action::skip)
+        engine.process (data, data, numSamples, network.conditioning.getFiLM (band), network.conditioning.getFiLMSlope (band));
+
+    network.bandGate.applyAction (action, data, numSamples);
+}
+
+void MBDistProcessor::mixNetworkSwap (const Tier& tier, float* const* bands, const float* const* retiringBands,
+                                      int swapElapsed, int numSamples) const noexcept
+{
+    // Like a tier switch, at the processing rate: the old network alone during the warm-up,
+    // then a linear crossfade to the new one
+    const float step = 1.0f / (float) (tierFadeLength << oversamplingOrder);
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        float* out = bands[band];
+        const float* old = retiringBands[band];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float gain = juce::jlimit (0.0f, 1.0f, (float) (swapElapsed + i - tier.swapWarmUp + 1) * step);
+            out[i] = old[i] + gain * (out[i] - old[i]);
+        }
+    }
+}
+
+void MBDistProcessor::updatePrecision()
+{
+    const auto newPrecision = (TCNEngine::Precision) juce::jlimit (0, qualityModes.size() - 1, (int) qualityParam->load());
+
+    if (newPrecision == precision)
+        return;
+
+    // Until the loader has built the reduced weights of every running model, stay on the current precision
+    if (newPrecision != TCNEngine::Precision::fp32)
+    {
+        for (auto& tier : tiers)
+        {
+            for (auto* network : { tier.network.get(), tier.retiring.get() })
+            {
+                if (network != nullptr && ! network->model->hasReducedWeights())
+                {
+                    reducedWeightsRequested.store (true);
+                    return;
+                }
+            }
+        }
+    }
+
+    // The engines convert their histories, so switching does not reset the sound
+    precision = newPrecision;
+
+    for (auto& tier : tiers)
+        for (auto* network : { tier.network.get(), tier.retiring.get() })
+            if (network != nullptr)
+                for (auto& engine : network->engines)
+                    engine.setPrecision (precision);
+}
+
+#ifdef BATCHED_INFERENCE
+void MBDistProcessor::processBatched (juce::AudioBuffer<float>& buffer, int numChannels)
+{
+    // A whole host cycle has passed since the last submission: the result should be waiting
+    if (batchFrameState != FrameState::none)
+        collectBatchedFrame (numChannels);
+
+    for (int pos = 0; pos < buffer.getNumSamples();)
+    {
+        // Only with irregular block sizes: the frame submitted earlier in this block is needed now
+        if (batchOutputFill == 0)
+            collectBatchedFrame (numChannels);
+
+        const int n = juce::jmin (maxChunkSize - batchInputFill, buffer.getNumSamples() - pos, batchOutputFill);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            batchInput.copyFrom (ch, batchInputFill, buffer, ch, pos, n);
+            buffer.copyFrom (ch, pos, batchOutput, ch, 0, n);
+
+            auto* fifo = batchOutput.getWritePointer (ch);
+            std::copy (fifo + n, fifo + batchOutputFill, fifo);
+        }
+
+        batchInputFill += n;
+        batchOutputFill -= n;
+        pos += n;
+
+        if (batchInputFill == maxChunkSize)
+        {
+            submitBatchedFrame (numChannels);
+            batchInputFill = 0;
+        }
+    }
+}
+
+void MBDistProcessor::submitBatchedFrame (int numChannels)
+{
+    // collectBatchedFrame() has always run since the last submission
+    jassert (! batchClient->isBusy());
+
+    const int order = juce::jlimit (0, maxOversamplingOrder, (int) oversamplingParam->load());
+    if (order != oversamplingOrder)
+        setOversamplingOrder (order);
+
+    updatePrecision();
+    updateTier();
+    updateNetworks();
+    applyPendingProgram (maxChunkSize);
+    updateConditioning (maxChunkSize << oversamplingOrder);
+
+    batchFrameOrder = oversamplingOrder;
+    batchFrameTier = currentTier;
+    batchFramePreviousTier = previousTier;
+
+    const int streamsPerNetwork = preparedNumChannels * NUM_BANDS;
+    const int numUpsampled = maxChunkSize << oversamplingOrder;
+
+    for (int t = 0; t < numModelTiers; ++t)
+    {
+        auto& tier = tiers[(size_t) t];
+        const int firstStream = getFirstStream (t, false);
+        const int firstRetiringStream = getFirstStream (t, true);
+        const bool running = isTierRunning (t);
+        const bool swapping = running && tier.retiring != nullptr;
+
+        batchFrameSwapElapsed[(size_t) t] = swapping ? tier.swapElapsed : -1;
+
+        if (! swapping)
+            for (int stream = 0; stream < streamsPerNetwork; ++stream)
+                batchClient->setFiLM (firstRetiringStream + stream, nullptr);
+
+        if (! running)
+        {
+            for (int stream = 0; stream < streamsPerNetwork; ++stream)
+                batchClient->setFiLM (firstStream + stream, nullptr);
+
+            continue;
+        }
+
+        // Every running tier gets its own copy of the frame, oversampled with its own filters
+        auto frame = getBatchFrame (t, numChannels);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::copy (frame.getChannelPointer ((size_t) ch), batchInput.getReadPointer (ch), maxChunkSize);
+
+        auto* oversampler = tier.oversamplers[(size_t) oversamplingOrder].get();
+
+        // Stays valid until the next processSamplesUp(), i.e. until this frame is collected
+        batchUpsampled[(size_t) t] = oversampler != nullptr ? oversampler->processSamplesUp (frame) : frame;
+
+        float* bands[NUM_BANDS];
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int band = 0; band < NUM_BANDS; ++band)
+                bands[band] = batchClient->getStreamBuffer (firstStream + ch * NUM_BANDS + band);
+
+            tier.crossovers[(size_t) oversamplingOrder].process (ch, batchUpsampled[(size_t) t].getChannelPointer ((size_t) ch),
+                                                                 bands, numUpsampled);
+
+            // During a swap the old network runs on a copy of the same bands
+            if (swapping)
+                for (int band = 0; band < NUM_BANDS; ++band)
+                    juce::FloatVectorOperations::copy (batchClient->getStreamBuffer (firstRetiringStream + ch * NUM_BANDS + band),
+                                                       bands[band], numUpsampled);
+        }
+
+        for (auto* network : { tier.network.get(), swapping ? tier.retiring.get() : nullptr })
+        {
+            if (network == nullptr || network->dilationScale == 0)
+                continue;
+
+            const int first = network == tier.network.get() ? firstStream : firstRetiringStream;
+
+            for (int stream = 0; stream < streamsPerNetwork; ++stream)
+            {
+                const auto* film = network->conditioning.getFiLM (stream % NUM_BANDS);
+                const auto action = network->bandGate.update (stream, batchClient->getStreamBuffer (first + stream), numUpsampled);
+
+                if (action == BandGate::Action::fadeIn)
+                    network->engines[(size_t) stream].settle (film);
+
+                if (action == BandGate::Action::skip)
+                    batchClient->setFiLM (first + stream, nullptr);
+                else
+                    batchClient->setFiLM (first + stream, film, network->conditioning.getFiLMSlope (stream % NUM_BANDS));
+            }
+        }
+
+        if (swapping)
+            tier.swapElapsed += numUpsampled;
+    }
+
+    batchClient->submit (numUpsampled);
+    batchFrameState = FrameState::submitted;
+}
+
+void MBDistProcessor::collectBatchedFrame (int numChannels)
+{
+    jassert (batchFrameState == FrameState::submitted);
+
+    // Late for the scheduler: the frame runs here, as it would without batching
+    if (! batchClient->collect (*bandWorkers))
+        ++batchInlineFrames;
+
+    const int streamsPerNetwork = preparedNumChannels * NUM_BANDS;
+    const int numUpsampled = maxChunkSize << batchFrameOrder;
+
+    for (int t : { batchFrameTier, batchFramePreviousTier })
+    {
+        if (t < 0)
+            continue;
+
+        // A swap cannot have ended since the submission (see updateNetworks()), so the retiring
+        // network is still the one that ran the frame
+        auto& tier = tiers[(size_t) t];
+        const int firstStream = getFirstStream (t, false);
+        const int firstRetiringStream = getFirstStream (t, true);
+        const int swapElapsed = batchFrameSwapElapsed[(size_t) t];
+
+        for (int stream = 0; stream < streamsPerNetwork; ++stream)
+            tier.network->bandGate.applyAction (tier.network->bandGate.getAction (stream),
+                                                batchClient->getStreamBuffer (firstStream + stream), numUpsampled);
+
+        if (swapElapsed >= 0)
+            for (int stream = 0; stream < streamsPerNetwork; ++stream)
+                tier.retiring->bandGate.applyAction (tier.retiring->bandGate.getAction (stream),
+                                                     batchClient->getStreamBuffer (firstRetiringStream + stream), numUpsampled);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* bands[NUM_BANDS];
+            const float* retiringBands[NUM_BANDS];
+
+            for (int band = 0; band < NUM_BANDS; ++band)
+            {
+                bands[band] = batchClient->getStreamBuffer (firstStream + ch * NUM_BANDS + band);
+                retiringBands[band] = batchClient->getStreamBuffer (firstRetiringStream + ch * NUM_BANDS + band);
+            }
+
+            if (swapElapsed >= 0)
+                mixNetworkSwap (tier, bands, retiringBands, swapElapsed, numUpsampled);
+
+            float* dest = batchUpsampled[(size_t) t].getChannelPointer ((size_t) ch);
+
+            juce::FloatVectorOperations::copy (dest, bands[0], numUpsampled);
+            for (int band = 1; band < NUM_BANDS; ++band)
+                juce::FloatVectorOperations::add (dest, bands[band], numUpsampled);
+        }
+
+        if (auto* oversampler = tier.oversamplers[(size_t) batchFrameOrder].get())
+            oversampler->processSamplesDown (getBatchFrame (t, numChannels));
+    }
+
+    if (batchFramePreviousTier >= 0)
+        mixTierSwitch (getBatchFrame (batchFrameTier, numChannels), getBatchFrame (batchFramePreviousTier, numChannels));
+
+    auto frame = getBatchFrame (batchFrameTier, numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        batchOutput.copyFrom (ch, batchOutputFill, frame.getChannelPointer ((size_t) ch), maxChunkSize);
+
+    batchOutputFill += maxChunkSize;
+    batchFrameState = FrameState::none;
+}
+
+int MBDistProcessor::getFirstStream (int tier, bool retiring) const noexcept
+{
+    return (tier * 2 + (retiring ? 1 : 0)) * preparedNumChannels * NUM_BANDS;
+}
+
+void MBDistProcessor::bindBatchStreams()
+{
+    // Only between frames: the worker holds no stream while the client is idle
+    jassert (! batchClient->isBusy());
+
+    for (int t = 0; t < numModelTiers; ++t)
+    {
+        for (bool retiring : { false, true })
+        {
+            auto* network = retiring ? tiers[(size_t) t].retiring.get() : tiers[(size_t) t].network.get();
+            const int first = getFirstStream (t, retiring);
+
+            // A network that cannot run at this rate is left out, like a missing one
+            if (network != nullptr && network->dilationScale == 0)
+                network = nullptr;
+
+            for (int stream = 0; stream < preparedNumChannels * NUM_BANDS; ++stream)
+                batchClient->setEngine (first + stream, network != nullptr ? &network->engines[(size_t) stream] : nullptr);
+        }
+    }
+}
+
+juce::dsp::AudioBlock<float> MBDistProcessor::getBatchFrame (int tier, int numChannels)
+{
+    // The frame buffer holds one copy of the input channels per tier
+    return juce::dsp::AudioBlock<float> (batchFrame).getSubsetChannelBlock ((size_t) (tier * batchInput.getNumChannels()),
+                                                                          (size_t) numChannels)
+                                                    .getSubBlock (0, (size_t) maxChunkSize);
+}
+#endif
+
+void MBDistProcessor::applyPendingProgram (int numSamples)
+{
+    const int program = pendingProgram.exchange (-1);
+
+    if (program < 0)
+    {
+        if (heldProgram >= 0)
+            programHoldRemaining -= numSamples;
+
+        return;
+    }
+
+    // Every network switches, so that a later tier change or swap finds the program already in
+    // place. The coefficients glide over this block, like parameter changes, rather than jump
+    const int rampLength = numSamples << oversamplingOrder;
+
+    for (auto& tier : tiers)
+        for (auto* network : { tier.network.get(), tier.retiring.get() })
+            if (network != nullptr && juce::isPositiveAndBelow (program, (int) network->programSnapshots.size()))
+                network->conditioning.applySnapshot (network->programSnapshots[(size_t) program], rampLength);
+
+    heldProgram = program;
+    programHoldRemaining = (int) (programHoldSeconds * currentSampleRate);
+}
+
+bool MBDistProcessor::matchesProgram (const std::array<ConditioningCache::Settings, NUM_BANDS>& settings,
+                                      const std::array<ConditioningCache::Settings, NUM_BANDS>& program) const noexcept
+{
+    // The parameters may not hold a program's values bit for bit (the host stores normalised
+    // values): anything within half a step of the parameter's range is the program's value
+    auto close = [] (const juce::RangedAudioParameter* param, float a, float b)
+    {
+        const auto& range = param->getNormalisableRange();
+        const float tolerance = range.interval > 0.0f ? 0.5f * range.interval : 1.0e-4f * (range.end - range.start);
+        return std::abs (a - b) <= tolerance;
+    };
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        const auto& s = settings[(size_t) band];
+        const auto& p = program[(size_t) band];
+
+        if (s.effect != p.effect || ! close (bandGainParameters[band], s.gain, p.gain)
+                                 || ! close (bandToneParameters[band], s.tone, p.tone))
+            return false;
+    }
+
+    return true;
+}
+
+void MBDistProcessor::updateConditioning (int rampLength)
+{
+    // The network's conditioning layers only run for bands whose settings moved. Gain and tone
+    // changes since the last block glide over the next rampLength samples at the processing rate,
+    // so automation is followed within the block without re-running the conditioning per sample.
+    std::array<ConditioningCache::Settings, NUM_BANDS> settings;
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        settings[(size_t) band].effect = (int) bandEffectParams[band]->load();
+        settings[(size_t) band].gain   = bandGainParams[band]->load();
+        settings[(size_t) band].tone   = bandToneParams[band]->load();
+    }
+
+    // Until the parameters of a program change have all arrived, the bands stay on the program
+    // rather than going back and forth between it and the previous values
+    if (heldProgram >= 0)
+    {
+        const auto& program = presets[heldProgram].bands;
+        const bool arrived = matchesProgram (settings, program);
+
+        // Parameters that have arrived take over from the next block, once the program's ramp
+        // has run: their values may differ from the program's in the last bits
+        if (arrived || programHoldRemaining > 0)
+            settings = program;
+
+        if (arrived || programHoldRemaining <= 0)
+            heldProgram = -1;
+    }
+
+    for (auto& tier : tiers)
+        for (auto* network : { tier.network.get(), tier.retiring.get() })
+            if (network != nullptr)
+                network->conditioning.update (settings, rampLength);
+}
+#endif
+
+//==============================================================================
+bool MBDistProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* MBDistProcessor::createEditor()
+{
+    return new MBDistEditor (*this);
+}
+
+//==============================================================================
+namespace
+{
+    // State: "PRST", version, current program, number of parameters, then per parameter its
+    // ID (null-terminated UTF-8) and normalised value, all little-endian
+    const char stateMagic[4] = { 'P', 'R', 'S', 'T' };
+    constexpr int stateVersion = 2;     // 2: cabinet IR file after the parameters
+}
+
+void MBDistProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    juce::MemoryOutputStream stream (destData, false);
+
+    juce::Array<juce::AudioProcessorParameterWithID*> parameters;
+    for (auto* param : getParameters())
+        if (auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param))
+            parameters.add (p);
+
+    stream.write (stateMagic, 4);
+    stream.writeInt (stateVersion);
+    stream.writeInt (currentProgram.load());
+    stream.writeInt (parameters.size());
+
+    for (auto* p : parameters)
+    {
+        stream.writeString (p->getParameterID());
+        stream.writeFloat (p->getValue());
+    }
+
+#ifdef NATIVE_INFERENCE
+    stream.writeString (cabinet.getImpulseResponseFile().getFullPathName());
+#else
+    stream.writeString ({});
+#endif
+}
+
+void MBDistProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    juce::MemoryInputStream stream (data, (size_t) juce::jmax (0, sizeInBytes), false);
+
+    char magic[4] = {};
+    if (stream.read (magic, 4) != 4 || std::memcmp (magic, stateMagic, 4) != 0)
+        return;
+
+    const int version = stream.readInt();
+    if (version > stateVersion)
+        return;
+
+    const int program = stream.readInt();
+    const int numParameters = stream.readInt();
+
+    // Matched by ID: parameters added since the state was saved keep their defaults
+    for (int i = 0; i < numParameters && ! stream.isExhausted(); ++i)
+    {
+        const auto id = stream.readString();
+        const float value = stream.readFloat();
+
+        if (auto* param = apvts.getParameter (id))
+            param->setValueNotifyingHost (juce::jlimit (0.0f, 1.0f, value));
+    }
+
+#ifdef NATIVE_INFERENCE
+    // An IR that has since gone missing is dropped rather than kept as a silent pass-through
+    const auto irPath = version >= 2 ? stream.readString() : juce::String();
+    const auto irFile = juce::File::isAbsolutePath (irPath) ? juce::File (irPath) : juce::File();
+    loadCabinetImpulseResponse (irFile.existsAsFile() ? irFile : juce::File());
+#endif
+
+    if (juce::isPositiveAndBelow (program, presets.size()))
+        currentProgram = program;
 }
 
 //==============================================================================
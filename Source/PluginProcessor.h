@@ -11,14 +11,53 @@
 #include <JuceHeader.h>
 
 #define NUM_BANDS 8
+#define NATIVE_INFERENCE
+
+// BATCHED_INFERENCE runs the networks of every Prism instance in the process as batches, sharded
+// across the shared worker pool, at the cost of one block of extra latency. Needs NATIVE_INFERENCE.
+// Set by the PRISM_BATCHED_INFERENCE CMake option; PrismBenchmarkBatched is always built with it.
+
+// Headless tools (offline renderer, benchmarks) build the processor without the backend links
+#ifndef PRISM_HEADLESS
 #define OSC 
+#define SHM_TRANSPORT
+#endif
+
+#ifdef NATIVE_INFERENCE
+#include "PrismModel.h"
+#include "TCNEngine.h"
+#include "Crossover.h"
+#include "ConditioningCache.h"
+#include "BandGate.h"
+#include "WorkerPool.h"
+#include "CabinetStage.h"
+#ifdef BATCHED_INFERENCE
+#include "InferenceScheduler.h"
+#endif
+#endif
+
+#include "PresetBank.h"
+
+#ifdef SHM_TRANSPORT
+#include "ShmTransport.h"
+#endif
+
+#ifdef OSC
+#include "OscPublisher.h"
+#endif
+
+// RT_INSTRUMENTATION (audio-thread load, allocation and lock counters) is opt-in: it replaces
+// the global operator new, so it is only set by the PRISM_RT_INSTRUMENTATION CMake option.
+#ifdef RT_INSTRUMENTATION
+#include "RtInstrumentation.h"
+#endif
 
 //==============================================================================
 /**
 */
-class MBDistProcessor  : public juce::AudioProcessor, 
+class MBDistProcessor  : public juce::AudioProcessor
                         #ifdef OSC
-                            AudioProcessorValueTreeState::Listener
+                          , private juce::AudioProcessorParameter::Listener
                         #endif
 {
 public:
@@ -27,6 +66,9 @@ public:
     MBDistProcessor();
     ~MBDistProcessor() override;
 
+    // Any layout up to this many discrete channels, each processed independently
+    static constexpr int maxNumChannels = 16;
+
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
@@ -65,16 +107,243 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createLayout();
 
     const static juce::StringArray bandEffects;
+
+#ifdef NATIVE_INFERENCE
+    /** The networks the plugin switches between at runtime ("Tier" parameter): the full
+        model for mixing, and for tracking a smaller one (prism-model-live) with minimum-phase
+        oversampling, for less CPU and latency. Without a live model the choice is disabled
+        and the full tier always runs.
+    */
+    enum class ModelTier { full, live };
+    static constexpr int numModelTiers = 2;
+
+    /** Replaces the network of a tier with the one in the given file. Not thread-safe: call
+        it before prepareToPlay() (or while processing is stopped).
+    */
+    bool loadModel (const juce::File& file, juce::String& errorMessage, ModelTier tier = ModelTier::full);
+
+    /** Replaces the network of a tier while the plugin plays. The file is read and the new
+        network prepared on a background thread; the audio thread then adopts it at the start
+        of a block, runs it unheard for its receptive field and crossfades to it, so a retrained
+        model can be auditioned without reloading the plugin. The file is copied rather than
+        mapped, so a training run may rewrite it in place afterwards. onFinished, if given, is called
+        (on the message thread if there is one) with an empty string once the network has been
+        handed over, or with the reason it could not be loaded.
+    */
+    void loadModelAsync (const juce::File& file, ModelTier tier = ModelTier::full,
+                         std::function<void (const juce::String& errorMessage)> onFinished = {});
+
+    bool hasModel() const;
+
+    /** False while the live tier has no network of its own, i.e. "Tier" has no effect. */
+    bool hasLiveModel() const noexcept          { return liveModelLoaded.load (std::memory_order_acquire); }
+
+    /** The tier being heard (the target of a switch under way). */
+    ModelTier getActiveTier() const noexcept    { return (ModelTier) activeTier.load (std::memory_order_relaxed); }
+
+    /** Sets the cabinet IR convolved with the output while the "Cabinet" parameter is on. The
+        file is read and prepared in the background; an empty file removes the IR.
+    */
+    void loadCabinetImpulseResponse (const juce::File& file);
+    juce::File getCabinetImpulseResponse() const;
+#endif
+    const static juce::StringArray oversamplingFactors;
+    const static juce::StringArray qualityModes;
+    const static juce::StringArray modelTiers;
 #ifdef OSC
-    void parameterChanged (const String& parameterID, float newValue) override;
     juce::String oscIP = "127.0.0.1";
     int oscPortOut = 9000;
     // Osc Sender
     std::unique_ptr<juce::OSCSender> oscSender;
+    // Sends coalesced parameter changes off the calling (possibly audio) thread
+    std::unique_ptr<OscPublisher> oscPublisher;
+#endif
+#ifdef SHM_TRANSPORT
+    // Name of this instance's shared-memory region, for the external backend to attach to
+    const juce::String shmName = ShmTransport::createUniqueName ("prism-transport");
+#endif
+#ifdef RT_INSTRUMENTATION
+    /** Block load, xrun-risk and allocation/lock counters; getSnapshot() is lock-free. */
+    RtInstrumentation& getInstrumentation() noexcept      { return instrumentation; }
 #endif
 
 
 private:
+#ifdef OSC
+    // Parameters are published by index (see OscPublisher), so nothing is looked up per change
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int, bool) override {}
+#endif
+
+    std::atomic<float>* bypassParam = nullptr;
+    std::atomic<float>* oversamplingParam = nullptr;
+    std::atomic<float>* qualityParam = nullptr;
+    std::atomic<float>* tierParam = nullptr;
+    class TierParameter;
+    TierParameter* tierParameter = nullptr;
+    std::atomic<float>* cabinetParam = nullptr;
+    std::array<std::atomic<float>*, NUM_BANDS> bandEffectParams {}, bandGainParams {}, bandToneParams {};
+    std::array<juce::RangedAudioParameter*, NUM_BANDS> bandEffectParameters {}, bandGainParameters {}, bandToneParameters {};
+
+    // Programs: the user's bank if there is one, else the factory presets
+    PresetBank presets;
+    std::atomic<int> currentProgram { 0 };
+
+#ifdef NATIVE_INFERENCE
+    // Oversampling (1x to 8x) around the band split and the networks, one crossover per rate
+    static constexpr int maxOversamplingOrder = 3;
+
+    // Native inference: one TCN stream per (channel, band), summed after the network. Everything
+    // that depends on the weights is one Network, so that a new model can be prepared off the
+    // audio thread and handed over whole.
+    struct Network
+    {
+        std::shared_ptr<const PrismModel> model;    // shared by every instance using the same file
+        std::vector<TCNEngine> engines;             // [channel * NUM_BANDS + band]
+        ConditioningCache conditioning;
+        BandGate bandGate;                          // skips the networks of idle bands, per engine
+        int dilationScale = 1;                      // 0 while the processing rate does not suit the model
+
+        // Every program's coefficients, so that program changes need no projection on the audio thread
+        std::vector<ConditioningCache::Snapshot> programSnapshots;
+    };
+
+    // Each tier has its own streams, so both can run while the plugin crossfades between them.
+    // Networks change hands without locks: the loader publishes a prepared one in incoming, the
+    // audio thread adopts it and, once the old one has faded out, hands that back in retired
+    // for the loader to delete.
+    struct Tier
+    {
+        std::shared_ptr<const PrismModel> model;    // the tier's own file, if any (loaderLock)
+        std::unique_ptr<Network> network, retiring; // audio thread; retiring is faded out after a swap
+        std::atomic<Network*> incoming { nullptr }, retired { nullptr };
+        int swapElapsed = 0, swapWarmUp = 0;        // at the processing rate
+        std::array<Crossover, maxOversamplingOrder + 1> crossovers;
+        std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, maxOversamplingOrder + 1> oversamplers; // [0] unused
+    };
+
+    class ModelLoader;
+
+    /** The network a tier runs: its own, else the full tier's. Call with loaderLock held. */
+    std::shared_ptr<const PrismModel> getTierModel (int tier) const;
+    bool isTierRunning (int tier) const noexcept    { return tier == currentTier || tier == previousTier; }
+
+    /** How far a model's dilations are spread so that it keeps its trained time spans at the
+        processing rate (host rate times oversampling factor): that rate over the model's. A
+        model only runs at whole multiples of its rate; otherwise this returns 0 and the plugin
+        passes the input through, delayed like processed audio. A 48 kHz model thus runs in
+        48 and 96 kHz sessions at any factor and in 24 kHz ones from 2x, but not at 44.1 kHz.
+    */
+    static int getDilationScale (const PrismModel& model, double hostRate, int oversamplingOrder) noexcept;
+
+    // Off the audio thread, with loaderLock held
+    std::unique_ptr<Network> createNetwork (std::shared_ptr<const PrismModel> model) const;
+    bool installModel (const juce::File& file, ModelTier tier, juce::String& errorMessage);
+    void reclaimNetworks();
+    void prepareRequestedWeights();
+
+    // Audio thread
+    bool updateNetworks();
+    void configureNetwork (Network& network) noexcept;
+    void endNetworkSwap (Tier& tier) noexcept;
+    void processBand (Network& network, int stream, float* data, int numSamples) noexcept;
+    void mixNetworkSwap (const Tier& tier, float* const* bands, const float* const* retiringBands,
+                         int swapElapsed, int numSamples) const noexcept;
+    void updateConditioning (int rampLength);
+    void setOversamplingOrder (int order);
+    void updatePrecision();
+    int getRequestedTier() const noexcept;
+    void updateTailLength (const PrismModel* model) noexcept;
+    void updateTier();
+    void updateLatency();
+    void delayDryInput (const juce::AudioBuffer<float>& buffer, int numChannels) noexcept;
+    void processTierChunk (int tier, juce::dsp::AudioBlock<float> chunk);
+    void mixTierSwitch (juce::dsp::AudioBlock<float> output, const juce::dsp::AudioBlock<float>& previous);
+    void applyPendingProgram (int numSamples);
+    bool matchesProgram (const std::array<ConditioningCache::Settings, NUM_BANDS>& settings,
+                         const std::array<ConditioningCache::Settings, NUM_BANDS>& program) const noexcept;
+
+    std::array<Tier, numModelTiers> tiers;
+    juce::AudioBuffer<float> bandBuffer;    // (2 * channels * NUM_BANDS) x (samplesPerBlock * max oversampling):
+                                            // the bands of every channel, then their copies for a retiring network
+    int maxChunkSize = 0;
+
+    // What prepareToPlay() sized the networks for, so that the loader can build matching ones
+    juce::CriticalSection loaderLock;
+    int preparedNumChannels = 0, preparedBlockSize = 0;
+    std::unique_ptr<ModelLoader> modelLoader;
+    std::atomic<bool> reducedWeightsRequested { false };    // by the audio thread, for the loader
+
+    int oversamplingOrder = 0;
+    TCNEngine::Precision precision = TCNEngine::Precision::fp32;
+    juce::SharedResourcePointer<WorkerPool> bandWorkers;   // one pool for every instance in the process
+    CabinetStage cabinet;
+
+    // Tier switches: the new tier first runs unheard for its receptive field, so that its
+    // networks have a history, then the output crossfades to it
+    static constexpr double tierFadeSeconds = 0.02;
+    int currentTier = 0, previousTier = -1;     // previousTier is -1 unless a switch is under way
+    std::atomic<int> activeTier { 0 };          // currentTier, for other threads
+    std::atomic<double> tailSeconds { 0.0 };    // the receptive field of the heard network
+    std::atomic<bool> liveModelLoaded { false };
+    int tierSwitchElapsed = 0, tierSwitchWarmUp = 0, tierFadeLength = 1;
+    juce::AudioBuffer<float> tierFadeBuffer;    // the chunk as rendered by the previous tier
+
+    // Bypass: the input, delayed by the reported latency, crossfaded with the processed signal
+    static constexpr double bypassFadeSeconds = 0.01;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> bypassDelay;
+    juce::AudioBuffer<float> bypassDryBuffer;
+    juce::SmoothedValue<float> bypassMix;       // 1 when bypassed
+    int maxBypassDelay = 0;
+
+    // Program changes reach the audio thread as an index into precomputed coefficients, one
+    // snapshot per network and program. The band parameters follow from the thread that changed
+    // the program; until they have all arrived (or the hold time is over) the bands stay on it.
+    static constexpr double programHoldSeconds = 0.1;
+    std::atomic<int> pendingProgram { -1 };
+    int heldProgram = -1, programHoldRemaining = 0;
+
+    // Below this many samples at the processing rate a chunk is not worth waking the workers for:
+    // a task is a single band, so the hand-over would cost about as much as the network
+    static constexpr int minParallelChunkSize = 64;
+    double currentSampleRate = 44100.0;
+
+   #ifdef BATCHED_INFERENCE
+    // Frames of maxChunkSize samples go to the shared scheduler and come back one frame later
+    enum class FrameState { none, submitted };
+
+    void processBatched (juce::AudioBuffer<float>& buffer, int numChannels);
+    void submitBatchedFrame (int numChannels);
+    void collectBatchedFrame (int numChannels);
+    juce::dsp::AudioBlock<float> getBatchFrame (int tier, int numChannels);
+    int getFirstStream (int tier, bool retiring) const noexcept;
+    void bindBatchStreams();
+
+    juce::SharedResourcePointer<InferenceScheduler> scheduler;
+    std::unique_ptr<InferenceScheduler::Client> batchClient;
+    juce::AudioBuffer<float> batchInput, batchFrame, batchOutput;  // input FIFO, frame in flight (per tier), output FIFO
+    int batchInputFill = 0, batchOutputFill = 0;
+    std::array<juce::dsp::AudioBlock<float>, numModelTiers> batchUpsampled; // the frame at the processing rate
+    int batchFrameOrder = 0;
+    int batchFrameTier = 0, batchFramePreviousTier = -1;           // the tiers that ran the frame
+    std::array<int, numModelTiers> batchFrameSwapElapsed {};         // -1 unless the tier was swapping networks
+    FrameState batchFrameState = FrameState::none;
+    std::atomic<int> batchInlineFrames { 0 };                    // frames the scheduler had not started in time
+   #endif
+#endif
+
+#ifdef SHM_TRANSPORT
+    void exchangeWithBackend (juce::AudioBuffer<float>& buffer);
+
+    std::unique_ptr<ShmTransport> shmTransport;
+    juce::uint32 shmSequence = 0;
+    std::atomic<int> shmMissedBlocks { 0 };
+#endif
+
+#ifdef RT_INSTRUMENTATION
+    RtInstrumentation instrumentation;
+#endif
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBDistProcessor)
 };
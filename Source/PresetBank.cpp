@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Programs of band settings, stored in a compact binary bank.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+    const char bankMagic[4] = { 'P', 'R', 'S', 'B' };
+
+    // Banks come from disk: keep a corrupt count from allocating without bound
+    constexpr juce::uint32 maxPresets = 4096;
+
+    enum Effect { distortion, fuzz, overdrive };
+
+    PresetBank::Preset makePreset (const juce::String& name, std::function<void (int band, ConditioningCache::Settings&)> setBand)
+    {
+        PresetBank::Preset preset;
+        preset.name = name;
+
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            auto& settings = preset.bands[(size_t) band];
+            settings.gain = 4.0f;
+            settings.tone = 4.0f;
+            setBand (band, settings);
+        }
+
+        return preset;
+    }
+}
+
+//==============================================================================
+PresetBank::PresetBank()
+{
+    // The parameter defaults first, so that program 0 is the freshly loaded plugin
+    presets.push_back (makePreset ("Default", [] (int band, auto& s) { s.effect = band / 3; }));
+    presets.push_back (makePreset ("All Distortion", [] (int, auto& s) { s.effect = distortion; }));
+    presets.push_back (makePreset ("All Fuzz", [] (int, auto& s) { s.effect = fuzz; }));
+    presets.push_back (makePreset ("All Overdrive", [] (int, auto& s) { s.effect = overdrive; }));
+
+    presets.push_back (makePreset ("Warm Bottom", [] (int band, auto& s)
+    {
+        const bool low = band < NUM_BANDS / 2;
+        s.effect = low ? overdrive : distortion;
+        s.gain = low ? 6.0f : 2.0f;
+        s.tone = low ? 2.0f : 4.0f;
+    }));
+
+    presets.push_back (makePreset ("Fuzz Top", [] (int band, auto& s)
+    {
+        const bool low = band < NUM_BANDS / 2;
+        s.effect = low ? overdrive : fuzz;
+        s.gain = low ? 2.0f : 8.0f;
+        s.tone = low ? 4.0f : 6.0f;
+    }));
+}
+
+bool PresetBank::loadFromFile (const juce::File& file, juce::String& errorMessage)
+{
+    juce::FileInputStream input (file);
+
+    if (! input.openedOk())
+    {
+        errorMessage = "Cannot open " + file.getFullPathName();
+        return false;
+    }
+
+    return loadFromStream (input, errorMessage);
+}
+
+bool PresetBank::loadFromStream (juce::InputStream& input, juce::String& errorMessage)
+{
+    char magic[4] = {};
+
+    if (input.read (magic, 4) != 4 || std::memcmp (magic, bankMagic, 4) != 0)
+    {
+        errorMessage = "Not a Prism preset bank";
+        return false;
+    }
+
+    const auto fileVersion = (juce::uint32) input.readInt();
+    const auto numPresets = (juce::uint32) input.readInt();
+
+    if (fileVersion > version)
+    {
+        errorMessage = "Preset bank version " + juce::String (fileVersion) + " is not supported";
+        return false;
+    }
+
+    if (numPresets == 0 || numPresets > maxPresets)
+    {
+        errorMessage = "Invalid number of presets: " + juce::String (numPresets);
+        return false;
+    }
+
+    // Smallest preset: an empty name, then the bands
+    const juce::int64 minPresetSize = 1 + NUM_BANDS * (1 + 2 * (juce::int64) sizeof (float));
+    const auto remaining = input.getNumBytesRemaining();
+
+    if (remaining >= 0 && remaining < (juce::int64) numPresets * minPresetSize)
+    {
+        errorMessage = "Preset bank is truncated";
+        return false;
+    }
+
+    std::vector<Preset> loaded (numPresets);
+
+    for (auto& preset : loaded)
+    {
+        preset.name = input.readString();
+
+        for (auto& band : preset.bands)
+        {
+            band.effect = juce::jlimit (0, PrismModel::numEffects - 1, (int) (juce::uint8) input.readByte());
+            band.gain = juce::jlimit (0.0f, 10.0f, input.readFloat());
+            band.tone = juce::jlimit (0.0f, 10.0f, input.readFloat());
+        }
+    }
+
+    presets = std::move (loaded);
+    return true;
+}
+
+void PresetBank::writeToStream (juce::OutputStream& output) const
+{
+    output.write (bankMagic, 4);
+    output.writeInt ((int) version);
+    output.writeInt ((int) presets.size());
+
+    for (auto& preset : presets)
+    {
+        output.writeString (preset.name);
+
+        for (auto& band : preset.bands)
+        {
+            output.writeByte ((char) band.effect);
+            output.writeFloat (band.gain);
+            output.writeFloat (band.tone);
+        }
+    }
+}
+
+juce::File PresetBank::getDefaultBankFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("OnyxDSP")
+               .getChildFile ("Prism")
+               .getChildFile ("prism-presets.bin");
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Programs of band settings, stored in a compact binary bank.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ConditioningCache.h"
+
+//==============================================================================
+/**
+    The plugin's programs. A preset holds the settings of every band, i.e. what
+    the networks are conditioned on; oversampling, quality and model tier are
+    performance settings and stay with the session.
+
+    Banks are binary files:
+
+        "PRSB", version (uint32), numPresets (uint32), then per preset
+        name (null-terminated UTF-8) and per band effect (uint8), gain, tone (float)
+
+    all little-endian. The bank is read once, on the message thread; everything
+    the audio thread needs to switch programs is precomputed from it (see
+    ConditioningCache::Snapshot).
+*/
+class PresetBank
+{
+public:
+    static constexpr juce::uint32 version = 1;
+
+    using BandSettings = std::array<ConditioningCache::Settings, NUM_BANDS>;
+
+    struct Preset
+    {
+        juce::String name;
+        BandSettings bands;
+    };
+
+    /** Starts with the factory programs. */
+    PresetBank();
+
+    /** Replaces the presets with those of a bank file. Returns false, leaving the bank
+        unchanged, if the file is missing or malformed.
+    */
+    bool loadFromFile (const juce::File& file, juce::String& errorMessage);
+    bool loadFromStream (juce::InputStream& input, juce::String& errorMessage);
+
+    void writeToStream (juce::OutputStream& output) const;
+
+    /** The user's bank, next to the model files. */
+    static juce::File getDefaultBankFile();
+
+    int size() const noexcept                               { return (int) presets.size(); }
+    const Preset& operator[] (int index) const noexcept     { return presets[(size_t) index]; }
+    Preset& getReference (int index) noexcept               { return presets[(size_t) index]; }
+
+private:
+    std::vector<Preset> presets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
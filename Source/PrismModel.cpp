@@ -0,0 +1,512 @@
+/*
+  ==============================================================================
+
+    PrismModel.cpp
+    Weights and conditioning of the Prism temporal convolutional network.
+
+  ==============================================================================
+*/
+
+#include "PrismModel.h"
+#include "TCNKernels.h"
+
+namespace
+{
+    struct BinaryHeader
+    {
+        char magic[8];                  // "PRISMTCN"
+        juce::uint32 version;
+        juce::uint32 channels;
+        juce::uint32 kernelSize;
+        juce::uint32 numLayers;
+        juce::uint32 conditioningSize;
+        juce::uint32 reserved0;
+        double sampleRate;
+        float outputBias;
+        juce::uint32 reserved1;
+        juce::uint64 imageSize;         // header, dilations and tensors, padding included
+        juce::uint8 reserved2[8];
+    };
+
+    static_assert (sizeof (BinaryHeader) == PrismModel::tensorAlignment,
+                   "The first tensor offset relies on the header filling one alignment unit");
+
+    const char binaryMagic[8] = { 'P', 'R', 'I', 'S', 'M', 'T', 'C', 'N' };
+
+    size_t alignUp (size_t offset)
+    {
+        return (offset + PrismModel::tensorAlignment - 1) & ~(PrismModel::tensorAlignment - 1);
+    }
+
+    size_t getFirstTensorOffset (size_t numLayers)
+    {
+        return alignUp (sizeof (BinaryHeader) + numLayers * sizeof (juce::uint32));
+    }
+
+    // Reads a flat array of numbers into a tensor of the image being built, checking its length
+    bool readTensor (const juce::var& value, const PrismModel::Tensor& dest,
+                     const juce::String& name, juce::String& errorMessage)
+    {
+        auto* array = value.getArray();
+
+        if (array == nullptr || (size_t) array->size() != dest.size())
+        {
+            errorMessage = "Tensor '" + name + "' should contain " + juce::String ((juce::int64) dest.size()) + " values";
+            return false;
+        }
+
+        // Only called on the heap image of a model being parsed, never on a mapped file
+        auto* values = const_cast<float*> (dest.data());
+
+        for (size_t i = 0; i < dest.size(); ++i)
+            values[i] = (float) (double) array->getReference ((int) i);
+
+        return true;
+    }
+}
+
+// Visits the tensors in image order; binding, sizing and parsing all walk this same list
+template <typename ModelType, typename Function>
+static void forEachModelTensor (ModelType& model, Function&& function)
+{
+    const auto C = (size_t) model.channels;
+    const auto K = (size_t) model.kernelSize;
+
+    function (model.inputWeight, C);
+    function (model.inputBias, C);
+
+    for (auto& layer : model.layers)
+    {
+        function (layer.convWeight, K * C * C);
+        function (layer.convBias, C);
+        function (layer.filmWeight, 2 * C * (size_t) PrismModel::conditioningSize);
+        function (layer.filmBias, 2 * C);
+        function (layer.mixWeight, C * C);
+        function (layer.mixBias, C);
+    }
+
+    function (model.outputWeight, C);
+}
+
+//==============================================================================
+juce::File PrismModel::getDefaultModelFile (const juce::String& variant)
+{
+    auto folder = juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                      .getChildFile ("OnyxDSP")
+                      .getChildFile ("Prism");
+
+    const auto name = variant.isEmpty() ? juce::String ("prism-model") : "prism-model-" + variant;
+
+    auto binary = folder.getChildFile (name + ".bin");
+    return binary.existsAsFile() ? binary : folder.getChildFile (name + ".json");
+}
+
+size_t PrismModel::getImageSize() const
+{
+    auto offset = getFirstTensorOffset (layers.size());
+
+    forEachModelTensor (*this, [&] (const Tensor&, size_t numValues)
+    {
+        offset = alignUp (offset + numValues * sizeof (float));
+    });
+
+    return offset;
+}
+
+void PrismModel::bindTensors (const char* newImage)
+{
+    image = newImage;
+    int8Stride = TCNKernels::getInt8Stride (channels);
+    auto offset = getFirstTensorOffset (layers.size());
+
+    forEachModelTensor (*this, [&] (Tensor& tensor, size_t numValues)
+    {
+        tensor.values = reinterpret_cast<const float*> (image + offset);
+        tensor.numValues = numValues;
+        offset = alignUp (offset + numValues * sizeof (float));
+    });
+}
+
+bool PrismModel::checkDimensions (const PrismModel& model, juce::String& errorMessage)
+{
+    if (model.channels <= 0 || model.channels > 4096 || model.kernelSize <= 0 || model.kernelSize > 1024
+        || model.layers.empty() || model.layers.size() > 4096)
+    {
+        errorMessage = "Model dimensions out of range";
+        return false;
+    }
+
+    // Summed wide: a huge dilation must not wrap around into a plausible size
+    juce::int64 receptiveField = 1;
+
+    for (auto& layer : model.layers)
+    {
+        if (layer.dilation < 1 || layer.dilation > maxReceptiveField)
+        {
+            errorMessage = "Invalid dilation";
+            return false;
+        }
+
+        receptiveField += (juce::int64) (model.kernelSize - 1) * layer.dilation;
+    }
+
+    if (receptiveField > maxReceptiveField)
+    {
+        errorMessage = "Receptive field too long (" + juce::String (receptiveField) + " samples)";
+        return false;
+    }
+
+    return true;
+}
+
+void PrismModel::prepareReducedWeights() const
+{
+    const juce::ScopedLock sl (reducedLock);
+
+    if (hasReducedWeights())
+        return;
+
+    const auto C = (size_t) channels;
+    const auto K = (size_t) kernelSize;
+    const auto stride = (size_t) int8Stride;
+
+    reducedLayers.resize (layers.size());
+
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        const auto& layer = layers[l];
+        auto& reduced = reducedLayers[l];
+
+        reduced.convHalf.resize (K * C * C);
+        reduced.mixHalf.resize (C * C);
+
+        for (size_t i = 0; i < reduced.convHalf.size(); ++i)
+            reduced.convHalf[i] = TCNKernels::floatToHalf (layer.convWeight[i]);
+
+        for (size_t i = 0; i < reduced.mixHalf.size(); ++i)
+            reduced.mixHalf[i] = TCNKernels::floatToHalf (layer.mixWeight[i]);
+
+        reduced.convInt8.assign (K * C * stride, 0);
+        reduced.mixInt8.assign (C * stride, 0);
+        reduced.convScales.resize (K * C);
+        reduced.mixScales.resize (C);
+
+        for (size_t row = 0; row < K * C; ++row)
+            reduced.convScales[row] = TCNKernels::quantise (layer.convWeight.data() + row * C,
+                                                            reduced.convInt8.data() + row * stride, channels);
+
+        for (size_t row = 0; row < C; ++row)
+            reduced.mixScales[row] = TCNKernels::quantise (layer.mixWeight.data() + row * C,
+                                                           reduced.mixInt8.data() + row * stride, channels);
+    }
+
+    reducedReady.store (true, std::memory_order_release);
+}
+
+bool PrismModel::writeBinary (juce::OutputStream& output) const
+{
+    return image != nullptr && output.write (image, getImageSize());
+}
+
+//==============================================================================
+std::unique_ptr<PrismModel> PrismModel::loadFromFile (const juce::File& file, juce::String& errorMessage, Storage storage)
+{
+    if (! file.existsAsFile())
+    {
+        errorMessage = "Model file not found: " + file.getFullPathName();
+        return nullptr;
+    }
+
+    char magic[sizeof (binaryMagic)] = {};
+    juce::FileInputStream stream (file);
+
+    if (stream.openedOk() && stream.read (magic, (int) sizeof (magic)) == (int) sizeof (magic)
+        && std::memcmp (magic, binaryMagic, sizeof (magic)) == 0)
+        return loadFromBinaryFile (file, errorMessage, storage);
+
+    juce::var json;
+    auto result = juce::JSON::parse (file.loadFileAsString(), json);
+
+    if (result.failed())
+    {
+        errorMessage = result.getErrorMessage();
+        return nullptr;
+    }
+
+    return loadFromJSON (json, errorMessage);
+}
+
+std::unique_ptr<PrismModel> PrismModel::loadFromBinaryFile (const juce::File& file, juce::String& errorMessage, Storage storage)
+{
+    std::unique_ptr<PrismModel> model (new PrismModel());
+    const char* data = nullptr;
+    size_t size = 0;
+
+    if (storage == Storage::copied)
+    {
+        const auto fileSize = file.getSize();
+        juce::FileInputStream stream (file);
+
+        if (fileSize >= (juce::int64) sizeof (BinaryHeader) && fileSize < (juce::int64) std::numeric_limits<int>::max() && stream.openedOk())
+        {
+            model->ownedImage.calloc ((size_t) fileSize + tensorAlignment);
+            auto* copy = juce::snapPointerToAlignment (model->ownedImage.get(), tensorAlignment);
+
+            if (stream.read (copy, (int) fileSize) == (int) fileSize)
+            {
+                data = copy;
+                size = (size_t) fileSize;
+            }
+        }
+    }
+    else
+    {
+        model->mappedFile = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+        data = static_cast<const char*> (model->mappedFile->getData());
+        size = model->mappedFile->getSize();
+    }
+
+    if (data == nullptr || size < sizeof (BinaryHeader))
+    {
+        errorMessage = "Could not read model file: " + file.getFullPathName();
+        return nullptr;
+    }
+
+    BinaryHeader header;
+    std::memcpy (&header, data, sizeof (header));
+
+    if (std::memcmp (header.magic, binaryMagic, sizeof (binaryMagic)) != 0)
+    {
+        errorMessage = "Not a Prism model file";
+        return nullptr;
+    }
+
+    if (header.version != binaryVersion)
+    {
+        errorMessage = "Unsupported model version " + juce::String ((int) header.version);
+        return nullptr;
+    }
+
+    if (header.conditioningSize != (juce::uint32) conditioningSize)
+    {
+        errorMessage = "Model was trained for a different number of bands";
+        return nullptr;
+    }
+
+    if (header.channels == 0 || header.channels > 4096 || header.kernelSize == 0 || header.kernelSize > 1024
+        || header.numLayers == 0 || header.numLayers > 4096 || size < getFirstTensorOffset (header.numLayers)
+        || ! (header.sampleRate > 0.0))
+    {
+        errorMessage = "Corrupt model header";
+        return nullptr;
+    }
+
+    model->channels   = (int) header.channels;
+    model->kernelSize = (int) header.kernelSize;
+    model->sampleRate = header.sampleRate;
+    model->outputBias = header.outputBias;
+    model->layers.resize (header.numLayers);
+
+    for (size_t l = 0; l < model->layers.size(); ++l)
+    {
+        juce::uint32 dilation;
+        std::memcpy (&dilation, data + sizeof (BinaryHeader) + l * sizeof (dilation), sizeof (dilation));
+
+        // Clamped so the cast cannot wrap; checkDimensions() rejects anything this large
+        model->layers[l].dilation = (int) juce::jmin (dilation, (juce::uint32) maxReceptiveField + 1);
+    }
+
+    if (! checkDimensions (*model, errorMessage))
+        return nullptr;
+
+    if (header.imageSize != model->getImageSize() || size < header.imageSize)
+    {
+        errorMessage = "Model file is truncated or does not match its header";
+        return nullptr;
+    }
+
+    model->bindTensors (data);
+    return model;
+}
+
+std::unique_ptr<PrismModel> PrismModel::loadFromJSON (const juce::var& json, juce::String& errorMessage)
+{
+    std::unique_ptr<PrismModel> model (new PrismModel());
+
+    model->channels   = (int) json.getProperty ("channels", 0);
+    model->kernelSize = (int) json.getProperty ("kernel_size", 0);
+    model->sampleRate = (double) json.getProperty ("sample_rate", 48000.0);
+
+    const auto C = (size_t) model->channels;
+    const auto K = (size_t) model->kernelSize;
+
+    if (model->channels <= 0 || model->kernelSize <= 0)
+    {
+        errorMessage = "Model is missing 'channels' or 'kernel_size'";
+        return nullptr;
+    }
+
+    if (! (model->sampleRate > 0.0))
+    {
+        errorMessage = "Invalid sample rate";
+        return nullptr;
+    }
+
+    auto* layers = json.getProperty ("layers", {}).getArray();
+
+    if (layers == nullptr || layers->isEmpty())
+    {
+        errorMessage = "Model has no layers";
+        return nullptr;
+    }
+
+    for (auto& layerJson : *layers)
+    {
+        Layer layer;
+        layer.dilation = (int) juce::jlimit (0.0, (double) maxReceptiveField + 1, (double) layerJson.getProperty ("dilation", 1));
+        model->layers.push_back (layer);
+    }
+
+    if (! checkDimensions (*model, errorMessage))
+        return nullptr;
+
+    model->outputBias = (float) (double) json.getProperty ("output", {}).getProperty ("bias", 0.0);
+
+    // Build the same image a binary model file holds, in aligned heap memory
+    const auto imageSize = model->getImageSize();
+    model->ownedImage.calloc (imageSize + tensorAlignment);
+    auto* image = juce::snapPointerToAlignment (model->ownedImage.get(), tensorAlignment);
+
+    BinaryHeader header {};
+    std::memcpy (header.magic, binaryMagic, sizeof (binaryMagic));
+    header.version          = binaryVersion;
+    header.channels         = (juce::uint32) C;
+    header.kernelSize       = (juce::uint32) K;
+    header.numLayers        = (juce::uint32) model->layers.size();
+    header.conditioningSize = (juce::uint32) conditioningSize;
+    header.sampleRate       = model->sampleRate;
+    header.outputBias       = model->outputBias;
+    header.imageSize        = imageSize;
+    std::memcpy (image, &header, sizeof (header));
+
+    for (size_t l = 0; l < model->layers.size(); ++l)
+    {
+        const auto dilation = (juce::uint32) model->layers[l].dilation;
+        std::memcpy (image + sizeof (BinaryHeader) + l * sizeof (dilation), &dilation, sizeof (dilation));
+    }
+
+    model->bindTensors (image);
+
+    auto input = json.getProperty ("input", {});
+    if (! readTensor (input.getProperty ("weight", {}), model->inputWeight, "input.weight", errorMessage)
+     || ! readTensor (input.getProperty ("bias", {}),   model->inputBias,   "input.bias",   errorMessage))
+        return nullptr;
+
+    for (size_t l = 0; l < model->layers.size(); ++l)
+    {
+        const auto& layerJson = layers->getReference ((int) l);
+        const auto& layer = model->layers[l];
+
+        auto conv = layerJson.getProperty ("conv", {});
+        auto film = layerJson.getProperty ("film", {});
+        auto mix  = layerJson.getProperty ("mix", {});
+
+        // PyTorch stores Conv1d weights as [out][in][kernel]: read it aside, then repack
+        std::vector<float> torchConv (K * C * C);
+        const Tensor torchConvView { torchConv.data(), torchConv.size() };
+
+        if (! readTensor (conv.getProperty ("weight", {}), torchConvView, "conv.weight", errorMessage)
+         || ! readTensor (conv.getProperty ("bias", {}), layer.convBias, "conv.bias", errorMessage)
+         || ! readTensor (film.getProperty ("weight", {}), layer.filmWeight, "film.weight", errorMessage)
+         || ! readTensor (film.getProperty ("bias", {}), layer.filmBias, "film.bias", errorMessage)
+         || ! readTensor (mix.getProperty ("weight", {}), layer.mixWeight, "mix.weight", errorMessage)
+         || ! readTensor (mix.getProperty ("bias", {}), layer.mixBias, "mix.bias", errorMessage))
+            return nullptr;
+
+        auto* convWeight = const_cast<float*> (layer.convWeight.data());
+
+        for (size_t o = 0; o < C; ++o)
+            for (size_t i = 0; i < C; ++i)
+                for (size_t k = 0; k < K; ++k)
+                    convWeight[(k * C + o) * C + i] = torchConv[(o * C + i) * K + k];
+    }
+
+    auto output = json.getProperty ("output", {});
+    if (! readTensor (output.getProperty ("weight", {}), model->outputWeight, "output.weight", errorMessage))
+        return nullptr;
+
+    return model;
+}
+
+std::shared_ptr<const PrismModel> PrismModel::loadShared (const juce::File& file, juce::String& errorMessage, Storage storage)
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::Time modificationTime;
+        juce::int64 size;
+        std::weak_ptr<const PrismModel> model;
+    };
+
+    static juce::CriticalSection lock;
+    static std::vector<Entry> entries;
+
+    // Held while loading too, so instances created together load the file once
+    const juce::ScopedLock sl (lock);
+
+    entries.erase (std::remove_if (entries.begin(), entries.end(),
+                                   [] (const Entry& entry) { return entry.model.expired(); }),
+                   entries.end());
+
+    const auto modificationTime = file.getLastModificationTime();
+    const auto size = file.getSize();
+
+    for (auto& entry : entries)
+        if (entry.file == file && entry.modificationTime == modificationTime && entry.size == size)
+            if (auto model = entry.model.lock())
+                if (storage == Storage::mapped || ! model->isMapped())
+                    return model;
+
+    std::shared_ptr<const PrismModel> model (loadFromFile (file, errorMessage, storage));
+
+    if (model != nullptr)
+        entries.push_back ({ file, modificationTime, size, model });
+
+    return model;
+}
+
+//==============================================================================
+int PrismModel::getReceptiveField() const
+{
+    int receptiveField = 1;
+
+    for (auto& layer : layers)
+        receptiveField += (kernelSize - 1) * layer.dilation;
+
+    return receptiveField;
+}
+
+void PrismModel::computeFiLM (int band, int effect, float gain, float tone, float* film) const
+{
+    float conditioning[conditioningSize] = {};
+    conditioning[juce::jlimit (0, numEffects - 1, effect)] = 1.0f;
+    conditioning[numEffects]     = gain / 10.0f;
+    conditioning[numEffects + 1] = tone / 10.0f;
+    conditioning[numEffects + 2 + juce::jlimit (0, NUM_BANDS - 1, band)] = 1.0f;
+
+    for (auto& layer : layers)
+    {
+        for (int row = 0; row < 2 * channels; ++row)
+        {
+            const float* w = layer.filmWeight.data() + (size_t) row * conditioningSize;
+            float sum = layer.filmBias[(size_t) row];
+
+            for (int j = 0; j < conditioningSize; ++j)
+                sum += w[j] * conditioning[j];
+
+            film[row] = sum;
+        }
+
+        film += 2 * channels;
+    }
+}
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    PrismModel.h
+    Weights and conditioning of the Prism temporal convolutional network.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef NUM_BANDS
+ #define NUM_BANDS 8
+#endif
+
+//==============================================================================
+/**
+    Weights of the conditioned TCN exported from the Python training code.
+
+    The network is run once per band on the band-limited signal:
+
+        x0      = inputWeight * s + inputBias                       (1 -> C)
+        z       = conv_d(x_l) * gamma_l + beta_l                    (dilated causal conv + FiLM)
+        x_l+1   = x_l + mix_l(tanh(z))                              (1x1 residual mix)
+        y       = outputWeight . x_L + outputBias                   (C -> 1)
+
+    gamma_l/beta_l come from a linear FiLM projection of the conditioning vector
+    [effect one-hot (3), gain / 10, tone / 10, band one-hot (NUM_BANDS)].
+
+    Convolution weights are stored as [kernel][out][in] so that the inner loop of
+    the engine runs over contiguous input channels.
+
+    All tensors live in one read-only weight image laid out as the binary model
+    format: a 64-byte header, the layer dilations, then every tensor in a fixed
+    order, each starting on a 64-byte boundary. A binary model file is that image
+    as-is and is memory-mapped rather than read; a JSON model is converted into
+    an aligned image in memory when it is parsed. Models are immutable once
+    loaded, so loadShared() lets every plugin instance in a process use a single
+    copy of the weights.
+*/
+class PrismModel
+{
+public:
+    static constexpr int numEffects = 3;
+    static constexpr int conditioningSize = numEffects + 2 + NUM_BANDS;
+
+    static constexpr juce::uint32 binaryVersion = 1;
+    static constexpr size_t tensorAlignment = 64;
+
+    /** Largest receptive field accepted from a file, in samples at the model's rate. It
+        bounds the layer histories the engine allocates (times the dilation scale).
+    */
+    static constexpr int maxReceptiveField = 1 << 16;
+
+    /** A read-only view of a tensor in the weight image. */
+    struct Tensor
+    {
+        const float* data() const noexcept                      { return values; }
+        size_t size() const noexcept                            { return numValues; }
+        float operator[] (size_t index) const noexcept          { return values[index]; }
+
+        const float* values = nullptr;
+        size_t numValues = 0;
+    };
+
+    struct Layer
+    {
+        int dilation = 1;
+        Tensor convWeight;  // [kernelSize][channels][channels]
+        Tensor convBias;    // [channels]
+        Tensor filmWeight;  // [2 * channels][conditioningSize]
+        Tensor filmBias;    // [2 * channels]
+        Tensor mixWeight;   // [channels][channels]
+        Tensor mixBias;     // [channels]
+    };
+
+    /** How a binary model file is held. A mapped file must only ever be replaced by renaming
+        a new file over it (as PrismModelConvert does): truncating or rewriting it in place
+        changes the weights under a running network, or faults on pages that are gone.
+        Files that may be rewritten that way, e.g. while auditioning a training run, are
+        better copied.
+    */
+    enum class Storage
+    {
+        mapped,     // shared, read in place
+        copied      // read into private memory
+    };
+
+    /** Loads a binary model or a JSON export, whichever the file contains. */
+    static std::unique_ptr<PrismModel> loadFromFile (const juce::File& file, juce::String& errorMessage,
+                                                     Storage storage = Storage::mapped);
+
+    /** Loads a model exported as JSON (PyTorch tensor layouts). */
+    static std::unique_ptr<PrismModel> loadFromJSON (const juce::var& json, juce::String& errorMessage);
+
+    /** Loads a binary model file: mapped read-only with the weights used in place, or copied. */
+    static std::unique_ptr<PrismModel> loadFromBinaryFile (const juce::File& file, juce::String& errorMessage,
+                                                           Storage storage = Storage::mapped);
+
+    /** Returns the process-wide instance of the model in a file, loading it on first use.
+        Instances are shared while anyone holds them and reloaded when the file changes. A
+        request for a copied model never gets a mapped one.
+    */
+    static std::shared_ptr<const PrismModel> loadShared (const juce::File& file, juce::String& errorMessage,
+                                                         Storage storage = Storage::mapped);
+
+    bool isMapped() const noexcept      { return mappedFile != nullptr; }
+
+    /** Writes the weight image, i.e. the binary model format. */
+    bool writeBinary (juce::OutputStream& output) const;
+
+    /** Default location of the model shipped next to the user's settings: the binary
+        model if there is one, else the JSON export. A variant (e.g. "live") names an
+        alternative network stored beside it as prism-model-<variant>.
+    */
+    static juce::File getDefaultModelFile (const juce::String& variant = {});
+
+    int getNumChannels() const          { return channels; }
+    int getKernelSize() const           { return kernelSize; }
+    int getNumLayers() const            { return (int) layers.size(); }
+    double getSampleRate() const        { return sampleRate; }
+
+    /** Number of past input samples (including the current one) that affect an output sample. */
+    int getReceptiveField() const;
+
+    /** Size of the per-band FiLM coefficient block: [layer][gamma (C), beta (C)]. */
+    int getFiLMSize() const             { return getNumLayers() * 2 * channels; }
+
+    /** Projects the (effect, gain, tone) settings of a band onto the FiLM coefficients of every layer. */
+    void computeFiLM (int band, int effect, float gain, float tone, float* film) const;
+
+    int channels = 0;
+    int kernelSize = 0;
+    double sampleRate = 48000.0;
+
+    Tensor inputWeight, inputBias;      // [channels]
+    std::vector<Layer> layers;
+    Tensor outputWeight;                // [channels]
+    float outputBias = 0.0f;
+
+    /** Copies of the layer weights for the reduced-precision modes of the engine (see
+        TCNKernels). int8 rows are quantised with one scale per output channel and kernel
+        tap, and padded to int8Stride values. They take about as much memory again as a
+        mapped model shares, so they are only built for models that run at fp16 or int8.
+    */
+    struct ReducedLayer
+    {
+        std::vector<juce::uint16> convHalf;     // [kernelSize][channels][channels]
+        std::vector<juce::uint16> mixHalf;      // [channels][channels]
+        std::vector<juce::int8> convInt8;       // [kernelSize][channels][int8Stride]
+        std::vector<juce::int8> mixInt8;        // [channels][int8Stride]
+        std::vector<float> convScales;          // [kernelSize][channels]
+        std::vector<float> mixScales;           // [channels]
+    };
+
+    int int8Stride = 0;
+
+    /** Builds the reduced-precision copies, on the first call only. Thread-safe, but not
+        for the audio thread.
+    */
+    void prepareReducedWeights() const;
+
+    /** Lock-free; the copies can be used once this returns true. */
+    bool hasReducedWeights() const noexcept         { return reducedReady.load (std::memory_order_acquire); }
+    const ReducedLayer& getReducedLayer (int layer) const noexcept
+    {
+        jassert (hasReducedWeights());
+        return reducedLayers[(size_t) layer];
+    }
+
+private:
+    PrismModel() = default;
+
+    static bool checkDimensions (const PrismModel& model, juce::String& errorMessage);
+
+    size_t getImageSize() const;
+    void bindTensors (const char* image);
+
+    // Backing store of the tensors: the mapped file, or an aligned heap copy
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    juce::HeapBlock<char> ownedImage;
+    const char* image = nullptr;
+
+    mutable juce::CriticalSection reducedLock;
+    mutable std::vector<ReducedLayer> reducedLayers;
+    mutable std::atomic<bool> reducedReady { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PrismModel)
+};
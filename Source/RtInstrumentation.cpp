@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+    RtInstrumentation.cpp
+    Audio-thread load, allocation and lock counters (opt-in).
+
+  ==============================================================================
+*/
+
+#include "RtInstrumentation.h"
+
+#ifdef RT_INSTRUMENTATION
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+    // Instance whose block is running on this thread, if any
+    thread_local RtInstrumentation* currentInstrumentation = nullptr;
+}
+
+//==============================================================================
+void RtInstrumentation::prepare (double sampleRate) noexcept
+{
+    secondsPerSample = 1.0 / sampleRate;
+    clear();
+}
+
+void RtInstrumentation::clear() noexcept
+{
+    for (auto* counter : { &blocks, &overruns, &nearMisses, &allocations, &deallocations, &lockAcquisitions })
+        counter->store (0, std::memory_order_relaxed);
+
+    for (auto& bin : loadHistogram)
+        bin.store (0, std::memory_order_relaxed);
+
+    for (auto& bin : timeHistogram)
+        bin.store (0, std::memory_order_relaxed);
+
+    totalLoad.store (0.0, std::memory_order_relaxed);
+    peakLoad.store (0.0f, std::memory_order_relaxed);
+}
+
+RtInstrumentation::Snapshot RtInstrumentation::getSnapshot() const noexcept
+{
+    Snapshot s;
+    s.blocks           = blocks.load (std::memory_order_relaxed);
+    s.overruns         = overruns.load (std::memory_order_relaxed);
+    s.nearMisses       = nearMisses.load (std::memory_order_relaxed);
+    s.allocations      = allocations.load (std::memory_order_relaxed);
+    s.deallocations    = deallocations.load (std::memory_order_relaxed);
+    s.lockAcquisitions = lockAcquisitions.load (std::memory_order_relaxed);
+    s.peakLoad         = peakLoad.load (std::memory_order_relaxed);
+    s.meanLoad         = s.blocks > 0 ? (float) (totalLoad.load (std::memory_order_relaxed) / (double) s.blocks) : 0.0f;
+
+    for (size_t i = 0; i < loadHistogram.size(); ++i)
+        s.loadHistogram[i] = loadHistogram[i].load (std::memory_order_relaxed);
+
+    for (size_t i = 0; i < timeHistogram.size(); ++i)
+        s.timeHistogram[i] = timeHistogram[i].load (std::memory_order_relaxed);
+
+    return s;
+}
+
+void RtInstrumentation::endBlock (int numSamples, juce::int64 elapsedTicks) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const double seconds = juce::Time::highResolutionTicksToSeconds (elapsedTicks);
+    const auto load = (float) (seconds / (numSamples * secondsPerSample));
+
+    increment (blocks);
+    increment (loadHistogram[(size_t) juce::jlimit (0, numLoadBins - 1, (int) (load * 10.0f))]);
+
+    const auto micros = seconds * 1.0e6;
+    const int timeBin = micros < 1.0 ? 0 : juce::jmin (numTimeBins - 1, 1 + (int) std::log2 (micros));
+    increment (timeHistogram[(size_t) timeBin]);
+
+    if (load > 1.0f)
+        increment (overruns);
+    else if (load > nearMissLoad)
+        increment (nearMisses);
+
+    totalLoad.store (totalLoad.load (std::memory_order_relaxed) + load, std::memory_order_relaxed);
+
+    if (load > peakLoad.load (std::memory_order_relaxed))
+        peakLoad.store (load, std::memory_order_relaxed);
+}
+
+//==============================================================================
+RtInstrumentation::BlockScope::BlockScope (RtInstrumentation& o, int n) noexcept
+    : owner (o),
+      previous (currentInstrumentation),
+      numSamples (n),
+      startTicks (juce::Time::getHighResolutionTicks())
+{
+    if (owner.resetPending.exchange (false, std::memory_order_relaxed))
+        owner.clear();
+
+    currentInstrumentation = &owner;
+}
+
+RtInstrumentation::BlockScope::~BlockScope()
+{
+    currentInstrumentation = previous;
+    owner.endBlock (numSamples, juce::Time::getHighResolutionTicks() - startTicks);
+}
+
+RtInstrumentation::TaskScope::TaskScope (RtInstrumentation& owner) noexcept
+    : previous (currentInstrumentation)
+{
+    currentInstrumentation = &owner;
+}
+
+RtInstrumentation::TaskScope::~TaskScope()
+{
+    currentInstrumentation = previous;
+}
+
+void RtInstrumentation::noteAllocation() noexcept
+{
+    if (auto* instrumentation = currentInstrumentation)
+        incrementShared (instrumentation->allocations);
+}
+
+void RtInstrumentation::noteDeallocation() noexcept
+{
+    if (auto* instrumentation = currentInstrumentation)
+        incrementShared (instrumentation->deallocations);
+}
+
+void RtInstrumentation::noteLockAcquired() noexcept
+{
+    if (auto* instrumentation = currentInstrumentation)
+        incrementShared (instrumentation->lockAcquisitions);
+}
+
+//==============================================================================
+// The array and nothrow forms call these, but the over-aligned forms (C++17) do not, so they
+// are replaced as well: SIMD state and other alignas() types are allocated through them.
+void* operator new (std::size_t size)
+{
+    RtInstrumentation::noteAllocation();
+
+    if (auto* ptr = std::malloc (size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        RtInstrumentation::noteDeallocation();
+
+    std::free (ptr);
+}
+
+void operator delete (void* ptr, std::size_t) noexcept
+{
+    ::operator delete (ptr);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    RtInstrumentation::noteAllocation();
+
+    const auto align = juce::jmax (sizeof (void*), (std::size_t) alignment);
+    size = (juce::jmax (size, (std::size_t) 1) + align - 1) & ~(align - 1);
+
+   #if JUCE_WINDOWS
+    if (auto* ptr = _aligned_malloc (size, align))
+        return ptr;
+   #else
+    if (auto* ptr = std::aligned_alloc (align, size))
+        return ptr;
+   #endif
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new (size, alignment);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return ::operator new (size, alignment); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return ::operator new (size, alignment, std::nothrow);
+}
+
+void operator delete (void* ptr, std::align_val_t) noexcept
+{
+    if (ptr != nullptr)
+        RtInstrumentation::noteDeallocation();
+
+   #if JUCE_WINDOWS
+    _aligned_free (ptr);
+   #else
+    std::free (ptr);
+   #endif
+}
+
+void operator delete[] (void* ptr, std::align_val_t alignment) noexcept                     { ::operator delete (ptr, alignment); }
+void operator delete (void* ptr, std::size_t, std::align_val_t alignment) noexcept          { ::operator delete (ptr, alignment); }
+void operator delete[] (void* ptr, std::size_t, std::align_val_t alignment) noexcept        { ::operator delete (ptr, alignment); }
+void operator delete (void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept    { ::operator delete (ptr, alignment); }
+void operator delete[] (void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept  { ::operator delete (ptr, alignment); }
+
+#if JUCE_LINUX
+// juce::CriticalSection, std::mutex and friends all end up here; juce::ScopedTryLock and
+// std::mutex::try_lock in the trylock variant. The real functions are looked up without a
+// function-local static, whose guard could itself take a lock.
+namespace
+{
+    template <typename Function>
+    Function findRealFunction (std::atomic<Function>& cache, const char* name) noexcept
+    {
+        auto function = cache.load (std::memory_order_acquire);
+
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+            cache.store (function, std::memory_order_release);
+        }
+
+        return function;
+    }
+
+    using LockFunction = int (*) (pthread_mutex_t*);
+    std::atomic<LockFunction> realLock { nullptr }, realTryLock { nullptr };
+}
+
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RtInstrumentation::noteLockAcquired();
+    return findRealFunction (realLock, "pthread_mutex_lock") (mutex);
+}
+
+extern "C" int pthread_mutex_trylock (pthread_mutex_t* mutex)
+{
+    RtInstrumentation::noteLockAcquired();
+    return findRealFunction (realTryLock, "pthread_mutex_trylock") (mutex);
+}
+#endif
+
+#endif // RT_INSTRUMENTATION
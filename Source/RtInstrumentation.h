@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    RtInstrumentation.h
+    Audio-thread load, allocation and lock counters (opt-in).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Measures every processed block against its deadline and counts the heap
+    allocations, frees and mutex acquisitions made on the audio thread while a
+    block is running, and on the WorkerPool helpers while they run its tasks.
+    Work done for several instances at once (the InferenceScheduler's batches)
+    is not attributed to any of them.
+
+    Built only with RT_INSTRUMENTATION (the PRISM_RT_INSTRUMENTATION CMake option),
+    because allocations are counted by replacing the global operator new/delete
+    (including the over-aligned forms), and locks by interposing pthread_mutex_lock
+    and pthread_mutex_trylock (Linux only; elsewhere the lock counter stays at zero).
+
+    The audio thread is the only writer of the block statistics; the allocation
+    and lock counters are also written by helpers, with atomic adds. Every counter
+    is a relaxed atomic, so getSnapshot() can be called from any thread (editor
+    timer, OSC publisher) without locking; counters in a snapshot may be one block
+    apart.
+*/
+class RtInstrumentation
+{
+public:
+    static constexpr int numLoadBins = 16;      // 10% of the deadline each, the last one is >= 150%
+    static constexpr int numTimeBins = 20;      // [0, 1) us, then [2^(i-1), 2^i) us, the last is open
+    static constexpr float nearMissLoad = 0.8f;
+
+    struct Snapshot
+    {
+        juce::uint64 blocks = 0;
+        juce::uint64 overruns = 0;              // blocks that took longer than their duration
+        juce::uint64 nearMisses = 0;            // blocks above nearMissLoad but within their duration
+        juce::uint64 allocations = 0;
+        juce::uint64 deallocations = 0;
+        juce::uint64 lockAcquisitions = 0;
+        float meanLoad = 0.0f;                  // block time / block duration
+        float peakLoad = 0.0f;
+        std::array<juce::uint64, numLoadBins> loadHistogram {};
+        std::array<juce::uint64, numTimeBins> timeHistogram {};
+    };
+
+    RtInstrumentation() = default;
+
+    void prepare (double sampleRate) noexcept;
+
+    /** Clears the statistics at the start of the next block. Any thread. */
+    void reset() noexcept       { resetPending.store (true, std::memory_order_relaxed); }
+
+    Snapshot getSnapshot() const noexcept;
+
+    //==============================================================================
+    /** Times a block and attributes the allocations and locks of the current thread to it. */
+    class BlockScope
+    {
+    public:
+        BlockScope (RtInstrumentation& owner, int numSamples) noexcept;
+        ~BlockScope();
+
+    private:
+        RtInstrumentation& owner;
+        RtInstrumentation* previous;
+        const int numSamples;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (BlockScope)
+    };
+
+    /** Attributes the allocations and locks of the current thread to a block's task running
+        on it, e.g. on a WorkerPool helper. Times nothing.
+    */
+    class TaskScope
+    {
+    public:
+        explicit TaskScope (RtInstrumentation& owner) noexcept;
+        ~TaskScope();
+
+    private:
+        RtInstrumentation* previous;
+
+        JUCE_DECLARE_NON_COPYABLE (TaskScope)
+    };
+
+    // Called by the replaced allocation and lock functions
+    static void noteAllocation() noexcept;
+    static void noteDeallocation() noexcept;
+    static void noteLockAcquired() noexcept;
+
+private:
+    void clear() noexcept;
+    void endBlock (int numSamples, juce::int64 elapsedTicks) noexcept;
+
+    static void increment (std::atomic<juce::uint64>& counter) noexcept
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // For the counters that helpers write as well
+    static void incrementShared (std::atomic<juce::uint64>& counter) noexcept
+    {
+        counter.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    double secondsPerSample = 1.0 / 44100.0;
+
+    std::atomic<bool> resetPending { false };
+    std::atomic<juce::uint64> blocks { 0 }, overruns { 0 }, nearMisses { 0 };
+    std::atomic<juce::uint64> allocations { 0 }, deallocations { 0 }, lockAcquisitions { 0 };
+    std::atomic<double> totalLoad { 0.0 };
+    std::atomic<float> peakLoad { 0.0f };
+    std::array<std::atomic<juce::uint64>, numLoadBins> loadHistogram {};
+    std::array<std::atomic<juce::uint64>, numTimeBins> timeHistogram {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RtInstrumentation)
+};
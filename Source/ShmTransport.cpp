@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+    ShmTransport.cpp
+    Shared-memory audio transport between the plugin and a local backend.
+
+  ==============================================================================
+*/
+
+#include "ShmTransport.h"
+
+#if JUCE_WINDOWS
+ #include <process.h>
+#else
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+ShmTransport::Frame* ShmTransport::Ring::beginWrite() noexcept
+{
+    const auto write = writeIndex.load (std::memory_order_relaxed);
+    const auto read  = readIndex.load (std::memory_order_acquire);
+
+    if (write - read >= (juce::uint32) ringCapacity)
+        return nullptr;
+
+    return &slots[write & (ringCapacity - 1)];
+}
+
+void ShmTransport::Ring::finishWrite() noexcept
+{
+    writeIndex.store (writeIndex.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+ShmTransport::Frame* ShmTransport::Ring::beginRead() noexcept
+{
+    const auto read  = readIndex.load (std::memory_order_relaxed);
+    const auto write = writeIndex.load (std::memory_order_acquire);
+
+    if (read == write)
+        return nullptr;
+
+    return &slots[read & (ringCapacity - 1)];
+}
+
+void ShmTransport::Ring::finishRead() noexcept
+{
+    readIndex.store (readIndex.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+//==============================================================================
+juce::File ShmTransport::getRegionFile (const juce::String& name)
+{
+   #if JUCE_LINUX
+    return juce::File ("/dev/shm").getChildFile (name);
+   #else
+    return juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile (name);
+   #endif
+}
+
+juce::String ShmTransport::createUniqueName (const juce::String& prefix)
+{
+    static std::atomic<int> counter { 0 };
+
+   #if JUCE_WINDOWS
+    const auto pid = (juce::int64) _getpid();
+   #else
+    const auto pid = (juce::int64) getpid();
+   #endif
+
+    return prefix + "-" + juce::String (pid) + "-" + juce::String (++counter);
+}
+
+ShmTransport::ShmTransport (const juce::String& name, Role r)
+    : role (r), file (getRegionFile (name))
+{
+    if (role == Role::plugin)
+    {
+        // Size the backing file; zeroed memory is a valid empty state for both rings
+        juce::MemoryBlock zeros (sizeof (Region), true);
+        if (! file.replaceWithData (zeros.getData(), zeros.getSize()))
+            return;
+    }
+    else if (file.getSize() < (juce::int64) sizeof (Region))
+    {
+        return;
+    }
+
+    mappedFile = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readWrite);
+
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < sizeof (Region))
+    {
+        mappedFile.reset();
+        return;
+    }
+
+    auto* mapped = static_cast<Region*> (mappedFile->getData());
+
+    if (role == Role::plugin)
+    {
+        mapped->regionVersion = version;
+        mapped->magicNumber.store (magic, std::memory_order_release);
+    }
+    else
+    {
+        if (mapped->magicNumber.load (std::memory_order_acquire) != magic || mapped->regionVersion != version)
+        {
+            mappedFile.reset();
+            return;
+        }
+
+        // Only take over from a backend whose heartbeat has stopped
+        if (mapped->backendAttached.load (std::memory_order_acquire) != 0)
+        {
+            const auto heartbeat = mapped->backendHeartbeat.load (std::memory_order_relaxed);
+            juce::Thread::sleep ((int) heartbeatTimeoutMs);
+
+            if (mapped->backendHeartbeat.load (std::memory_order_relaxed) != heartbeat)
+            {
+                mappedFile.reset();
+                return;
+            }
+        }
+
+        lastBeatTime = juce::Time::getMillisecondCounter();
+        mapped->backendHeartbeat.fetch_add (1, std::memory_order_relaxed);
+        mapped->backendAttached.store (1, std::memory_order_release);
+    }
+
+    region = mapped;
+}
+
+bool ShmTransport::isBackendAttached() noexcept
+{
+    jassert (role == Role::plugin);
+
+    if (region == nullptr || region->backendAttached.load (std::memory_order_acquire) == 0)
+    {
+        backendSeen = false;
+        return false;
+    }
+
+    const auto now = juce::Time::getMillisecondCounter();
+    const auto heartbeat = region->backendHeartbeat.load (std::memory_order_relaxed);
+
+    if (! backendSeen || heartbeat != lastHeartbeat)
+    {
+        backendSeen = true;
+        lastHeartbeat = heartbeat;
+        lastHeartbeatTime = now;
+        return true;
+    }
+
+    if (now - lastHeartbeatTime < heartbeatTimeoutMs)
+        return true;
+
+    // The backend was killed or crashed without detaching
+    region->backendAttached.store (0, std::memory_order_release);
+    backendSeen = false;
+    return false;
+}
+
+void ShmTransport::beat() noexcept
+{
+    jassert (role == Role::backend);
+
+    const auto now = juce::Time::getMillisecondCounter();
+
+    if (region != nullptr && now - lastBeatTime >= heartbeatIntervalMs)
+    {
+        region->backendHeartbeat.fetch_add (1, std::memory_order_relaxed);
+        lastBeatTime = now;
+    }
+}
+
+ShmTransport::~ShmTransport()
+{
+    if (region != nullptr && role == Role::backend)
+        region->backendAttached.store (0, std::memory_order_release);
+
+    region = nullptr;
+    mappedFile.reset();
+
+    if (role == Role::plugin)
+        file.deleteFile();
+}
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    ShmTransport.h
+    Shared-memory audio transport between the plugin and a local backend.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+//==============================================================================
+/**
+    Two single-producer/single-consumer rings living in a memory-mapped file
+    (/dev/shm on Linux, the temp folder elsewhere): one carries audio and
+    parameter frames to the backend, the other brings processed frames back.
+
+    Both ends only touch atomics and plain memory, so exchanging a block costs
+    no system calls. Every plugin instance creates its own region, named with
+    createUniqueName(); a backend attaches to one of them. While attached the
+    backend keeps bumping a heartbeat counter, so that the plugin notices a
+    backend that died without detaching.
+*/
+class ShmTransport
+{
+public:
+    static constexpr juce::uint32 magic = 0x5052534d; // 'PRSM'
+    static constexpr juce::uint32 version = 2;
+    static constexpr int ringCapacity = 4;             // power of two
+    static constexpr int maxChannels = 16;
+    static constexpr int maxSamples = 2048;
+    static constexpr int maxParameters = 32;
+    static constexpr juce::uint32 heartbeatIntervalMs = 20;
+    static constexpr juce::uint32 heartbeatTimeoutMs = 500;
+
+    struct Frame
+    {
+        juce::uint32 sequence;
+        juce::uint32 numChannels;
+        juce::uint32 numSamples;
+        juce::uint32 numParameters;
+        float parameters[maxParameters];
+        float audio[maxChannels][maxSamples];
+    };
+
+    /** Wait-free SPSC ring of frames. Indices grow monotonically and wrap on the mask. */
+    struct Ring
+    {
+        /** Returns the next free slot, or nullptr if the ring is full. Producer only. */
+        Frame* beginWrite() noexcept;
+        void finishWrite() noexcept;
+
+        /** Returns the oldest pending frame, or nullptr if the ring is empty. Consumer only. */
+        Frame* beginRead() noexcept;
+        void finishRead() noexcept;
+
+        alignas (64) std::atomic<juce::uint32> writeIndex;
+        alignas (64) std::atomic<juce::uint32> readIndex;
+        alignas (64) Frame slots[ringCapacity];
+    };
+
+    struct Region
+    {
+        std::atomic<juce::uint32> magicNumber;
+        juce::uint32 regionVersion;
+        std::atomic<juce::uint32> backendAttached;
+        alignas (64) std::atomic<juce::uint32> backendHeartbeat;
+        Ring toBackend;
+        Ring toPlugin;
+    };
+
+    static_assert (std::atomic<juce::uint32>::is_always_lock_free, "Shared-memory rings need address-free atomics");
+    static_assert ((ringCapacity & (ringCapacity - 1)) == 0, "Ring capacity must be a power of two");
+
+    enum class Role
+    {
+        plugin,     // creates (and removes) the region
+        backend     // attaches to an existing region
+    };
+
+    ShmTransport (const juce::String& name, Role role);
+    ~ShmTransport();
+
+    bool isOpen() const noexcept                { return region != nullptr; }
+
+    /** True while a backend is attached and its heartbeat keeps moving; a backend that
+        stopped beating is detached, so another one can take its place. Plugin only.
+    */
+    bool isBackendAttached() noexcept;
+
+    /** Backend only: call at least every heartbeatIntervalMs while attached. */
+    void beat() noexcept;
+
+    /** The ring this side writes to / reads from. */
+    Ring& getOutgoing() noexcept                { return role == Role::plugin ? region->toBackend : region->toPlugin; }
+    Ring& getIncoming() noexcept                { return role == Role::plugin ? region->toPlugin : region->toBackend; }
+
+    static juce::File getRegionFile (const juce::String& name);
+
+    /** A region name no other instance uses: the prefix, the process id and a counter. */
+    static juce::String createUniqueName (const juce::String& prefix);
+
+    /** Busy-wait hint that does not enter the kernel. */
+    static inline void cpuRelax() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+
+private:
+    Role role;
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    Region* region = nullptr;
+
+    // Heartbeat tracking, plugin side
+    bool backendSeen = false;
+    juce::uint32 lastHeartbeat = 0, lastHeartbeatTime = 0;
+
+    // Backend side
+    juce::uint32 lastBeatTime = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ShmTransport)
+};
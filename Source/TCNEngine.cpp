@@ -0,0 +1,487 @@
+/*
+  ==============================================================================
+
+    TCNEngine.cpp
+    Real-time inference of the Prism TCN on a single band stream.
+
+  ==============================================================================
+*/
+
+#include "TCNEngine.h"
+
+namespace
+{
+    /** FiLM of output channel o for one layer: film holds [gamma (C), beta (C)], and slope,
+        if not null, their change per sample along a conditioning ramp at sample t.
+    */
+    inline float applyFiLM (float z, const float* film, const float* slope, int o, int C, float t) noexcept
+    {
+        if (slope == nullptr)
+            return z * film[o] + film[C + o];
+
+        return z * (film[o] + slope[o] * t) + (film[C + o] + slope[C + o] * t);
+    }
+}
+
+//==============================================================================
+void TCNEngine::prepare (const PrismModel& m, int /*maximumBlockSize*/, int maximumDilationScale)
+{
+    model = &m;
+    maxDilationScale = juce::jmax (1, maximumDilationScale);
+
+    const auto C = (size_t) model->getNumChannels();
+    const auto stride = (size_t) model->int8Stride;
+
+    layerStates.resize ((size_t) model->getNumLayers());
+
+    for (size_t l = 0; l < layerStates.size(); ++l)
+    {
+        const int span = (model->getKernelSize() - 1) * model->layers[l].dilation * maxDilationScale + 1;
+        const auto numFrames = (size_t) juce::nextPowerOfTwo (span);
+        layerStates[l].ring.assign (numFrames * C, 0.0f);
+        layerStates[l].ring8.assign (numFrames * stride, 0);
+        layerStates[l].ringScales.assign (numFrames, 0.0f);
+    }
+
+    frame.assign (C, 0.0f);
+    activation.assign (C, 0.0f);
+    convSums.assign (C, 0.0f);
+    residual.assign (C, 0.0f);
+    activation8.assign (stride, 0);
+
+    setDilationScale (1);
+}
+
+void TCNEngine::setDilationScale (int scale) noexcept
+{
+    jassert (scale >= 1 && scale <= maxDilationScale);
+    scale = juce::jlimit (1, maxDilationScale, scale);
+    dilationScale = scale;
+
+    positionMask = 0;
+
+    for (size_t l = 0; l < layerStates.size(); ++l)
+    {
+        auto& state = layerStates[l];
+        state.dilation = model->layers[l].dilation * scale;
+        state.mask = juce::nextPowerOfTwo ((model->getKernelSize() - 1) * state.dilation + 1) - 1;
+        positionMask = juce::jmax (positionMask, state.mask);
+    }
+
+    reset();
+}
+
+void TCNEngine::setPrecision (Precision newPrecision) noexcept
+{
+    if (newPrecision == precision)
+        return;
+
+    // The caller makes the model build its reduced weights first (off the audio thread)
+    jassert (newPrecision == Precision::fp32 || model == nullptr || model->hasReducedWeights());
+
+    // fp32 and fp16 share the float history; int8 keeps its own quantised copy
+    const bool wasInt8 = precision == Precision::int8;
+    const bool isInt8 = newPrecision == Precision::int8;
+    precision = newPrecision;
+
+    if (wasInt8 == isInt8 || model == nullptr)
+        return;
+
+    const int C = model->getNumChannels();
+    const auto stride = (size_t) model->int8Stride;
+
+    for (auto& state : layerStates)
+    {
+        for (int f = 0; f <= state.mask; ++f)
+        {
+            float* values = state.ring.data() + (size_t) f * (size_t) C;
+            juce::int8* quantised = state.ring8.data() + (size_t) f * stride;
+
+            if (isInt8)
+            {
+                state.ringScales[(size_t) f] = TCNKernels::quantise (values, quantised, C);
+            }
+            else
+            {
+                for (int c = 0; c < C; ++c)
+                    values[c] = (float) quantised[c] * state.ringScales[(size_t) f];
+            }
+        }
+    }
+}
+
+void TCNEngine::reset()
+{
+    for (auto& state : layerStates)
+    {
+        std::fill (state.ring.begin(), state.ring.end(), 0.0f);
+        std::fill (state.ring8.begin(), state.ring8.end(), (juce::int8) 0);
+        std::fill (state.ringScales.begin(), state.ringScales.end(), 0.0f);
+    }
+
+    position = 0;
+}
+
+void TCNEngine::settle (const float* film) noexcept
+{
+    jassert (isPrepared());
+
+    const int C = model->getNumChannels();
+    const int K = model->getKernelSize();
+    const auto stride = (size_t) model->int8Stride;
+
+    // With a constant input every tap of a layer sees the same frame, so one pass gives the fixed point
+    float* x = frame.data();
+    std::copy (model->inputBias.data(), model->inputBias.data() + C, x);
+
+    for (size_t l = 0; l < layerStates.size(); ++l)
+    {
+        const auto& layer = model->layers[l];
+        auto& state = layerStates[l];
+
+        const float* gamma = film + l * 2 * (size_t) C;
+        const float* beta  = gamma + C;
+
+        if (precision == Precision::int8)
+        {
+            const float scale = TCNKernels::quantise (x, activation8.data(), C);
+
+            for (int f = 0; f <= state.mask; ++f)
+            {
+                std::copy (activation8.begin(), activation8.end(), state.ring8.data() + (size_t) f * stride);
+                state.ringScales[(size_t) f] = scale;
+            }
+        }
+        else
+        {
+            for (int f = 0; f <= state.mask; ++f)
+                std::copy (x, x + C, state.ring.data() + (size_t) f * (size_t) C);
+        }
+
+        for (int o = 0; o < C; ++o)
+        {
+            float z = layer.convBias[(size_t) o];
+
+            for (int k = 0; k < K; ++k)
+            {
+                const float* w = layer.convWeight.data() + ((size_t) k * (size_t) C + (size_t) o) * (size_t) C;
+
+                for (int i = 0; i < C; ++i)
+                    z += w[i] * x[i];
+            }
+
+            activation[(size_t) o] = std::tanh (z * gamma[o] + beta[o]);
+        }
+
+        for (int o = 0; o < C; ++o)
+        {
+            const float* w = layer.mixWeight.data() + (size_t) o * (size_t) C;
+            float r = layer.mixBias[(size_t) o];
+
+            for (int i = 0; i < C; ++i)
+                r += w[i] * activation[(size_t) i];
+
+            x[o] += r;
+        }
+    }
+}
+
+void TCNEngine::process (const float* input, float* output, int numSamples, const float* film,
+                         const float* filmSlope) noexcept
+{
+    jassert (isPrepared());
+
+    if (precision == Precision::fp32)
+        processFloat (input, output, numSamples, film, filmSlope);
+    else
+        processReduced (input, output, numSamples, film, filmSlope);
+}
+
+void TCNEngine::processFloat (const float* input, float* output, int numSamples, const float* film,
+                              const float* filmSlope) noexcept
+{
+    const int C = model->getNumChannels();
+    const int K = model->getKernelSize();
+    const int numLayers = model->getNumLayers();
+
+    float* x = frame.data();
+
+    for (int t = 0; t < numSamples; ++t)
+    {
+        for (int c = 0; c < C; ++c)
+            x[c] = model->inputWeight[(size_t) c] * input[t] + model->inputBias[(size_t) c];
+
+        for (int l = 0; l < numLayers; ++l)
+        {
+            const auto& layer = model->layers[(size_t) l];
+            auto& state = layerStates[(size_t) l];
+
+            const float* layerFiLM = film + (size_t) l * 2 * (size_t) C;
+            const float* layerSlope = filmSlope != nullptr ? filmSlope + (size_t) l * 2 * (size_t) C : nullptr;
+
+            std::copy (x, x + C, state.ring.data() + (size_t) (position & state.mask) * (size_t) C);
+
+            for (int o = 0; o < C; ++o)
+            {
+                float z = layer.convBias[(size_t) o];
+
+                for (int k = 0; k < K; ++k)
+                {
+                    const int tap = (position - (K - 1 - k) * state.dilation) & state.mask;
+                    const float* past = state.ring.data() + (size_t) tap * (size_t) C;
+                    const float* w = layer.convWeight.data() + ((size_t) k * (size_t) C + (size_t) o) * (size_t) C;
+
+                    for (int i = 0; i < C; ++i)
+                        z += w[i] * past[i];
+                }
+
+                activation[(size_t) o] = std::tanh (applyFiLM (z, layerFiLM, layerSlope, o, C, (float) t));
+            }
+
+            // Residual update in place: x now holds the input of the next layer
+            for (int o = 0; o < C; ++o)
+            {
+                const float* w = layer.mixWeight.data() + (size_t) o * (size_t) C;
+                float r = layer.mixBias[(size_t) o];
+
+                for (int i = 0; i < C; ++i)
+                    r += w[i] * activation[(size_t) i];
+
+                x[o] += r;
+            }
+        }
+
+        float y = model->outputBias;
+
+        for (int c = 0; c < C; ++c)
+            y += model->outputWeight[(size_t) c] * x[c];
+
+        output[t] = y;
+        position = (position + 1) & positionMask;
+    }
+}
+
+void TCNEngine::processReduced (const float* input, float* output, int numSamples, const float* film,
+                                const float* filmSlope) noexcept
+{
+    const auto& kernels = TCNKernels::get();
+    const bool useInt8 = precision == Precision::int8;
+
+    const int C = model->getNumChannels();
+    const int K = model->getKernelSize();
+    const int numLayers = model->getNumLayers();
+    const int stride = model->int8Stride;
+
+    float* x = frame.data();
+    float* z = convSums.data();
+    float* r = residual.data();
+
+    for (int t = 0; t < numSamples; ++t)
+    {
+        for (int c = 0; c < C; ++c)
+            x[c] = model->inputWeight[(size_t) c] * input[t] + model->inputBias[(size_t) c];
+
+        for (int l = 0; l < numLayers; ++l)
+        {
+            const auto& layer = model->layers[(size_t) l];
+            const auto& reduced = model->getReducedLayer (l);
+            auto& state = layerStates[(size_t) l];
+
+            const float* layerFiLM = film + (size_t) l * 2 * (size_t) C;
+            const float* layerSlope = filmSlope != nullptr ? filmSlope + (size_t) l * 2 * (size_t) C : nullptr;
+
+            const int slot = position & state.mask;
+
+            if (useInt8)
+                state.ringScales[(size_t) slot] = TCNKernels::quantise (x, state.ring8.data() + (size_t) slot * (size_t) stride, C);
+            else
+                std::copy (x, x + C, state.ring.data() + (size_t) slot * (size_t) C);
+
+            std::copy (layer.convBias.data(), layer.convBias.data() + C, z);
+
+            for (int k = 0; k < K; ++k)
+            {
+                const int tap = (position - (K - 1 - k) * state.dilation) & state.mask;
+
+                if (useInt8)
+                    kernels.matVecInt8 (reduced.convInt8.data() + (size_t) k * (size_t) C * (size_t) stride,
+                                        reduced.convScales.data() + (size_t) k * (size_t) C,
+                                        state.ring8.data() + (size_t) tap * (size_t) stride, state.ringScales[(size_t) tap],
+                                        z, C, stride);
+                else
+                    kernels.matVecHalf (reduced.convHalf.data() + (size_t) k * (size_t) C * (size_t) C,
+                                        state.ring.data() + (size_t) tap * (size_t) C, z, C, C);
+            }
+
+            for (int o = 0; o < C; ++o)
+                activation[(size_t) o] = std::tanh (applyFiLM (z[o], layerFiLM, layerSlope, o, C, (float) t));
+
+            std::copy (layer.mixBias.data(), layer.mixBias.data() + C, r);
+
+            if (useInt8)
+            {
+                const float scale = TCNKernels::quantise (activation.data(), activation8.data(), C);
+                kernels.matVecInt8 (reduced.mixInt8.data(), reduced.mixScales.data(), activation8.data(), scale, r, C, stride);
+            }
+            else
+            {
+                kernels.matVecHalf (reduced.mixHalf.data(), activation.data(), r, C, C);
+            }
+
+            for (int o = 0; o < C; ++o)
+                x[o] += r[o];
+        }
+
+        float y = model->outputBias;
+
+        for (int c = 0; c < C; ++c)
+            y += model->outputWeight[(size_t) c] * x[c];
+
+        output[t] = y;
+        position = (position + 1) & positionMask;
+    }
+}
+
+void TCNEngine::processBatch (TCNEngine* const* engines, float* const* buffers, const float* const* films,
+                              const float* const* filmSlopes, const int* numSamples, int numStreams,
+                              BatchScratch& scratch)
+{
+    if (numStreams <= 0)
+        return;
+
+    if (engines[0]->precision != Precision::fp32)
+    {
+        for (int s = 0; s < numStreams; ++s)
+        {
+            jassert (engines[s]->precision == engines[0]->precision);
+            engines[s]->process (buffers[s], buffers[s], numSamples[s], films[s], filmSlopes[s]);
+        }
+
+        return;
+    }
+
+    const auto& model = *engines[0]->model;
+    const int C = model.getNumChannels();
+    const int K = model.getKernelSize();
+    const int numLayers = model.getNumLayers();
+
+    int maxSamples = 0;
+    for (int s = 0; s < numStreams; ++s)
+    {
+        jassert (engines[s]->model == &model && engines[s]->dilationScale == engines[0]->dilationScale);
+        maxSamples = juce::jmax (maxSamples, numSamples[s]);
+    }
+
+    scratch.z.resize ((size_t) numStreams);
+    scratch.taps.resize ((size_t) (numStreams * K));
+
+    float* z = scratch.z.data();
+    const float** taps = scratch.taps.data();
+
+    for (int t = 0; t < maxSamples; ++t)
+    {
+        for (int s = 0; s < numStreams; ++s)
+        {
+            if (t >= numSamples[s])
+                continue;
+
+            float* x = engines[s]->frame.data();
+
+            for (int c = 0; c < C; ++c)
+                x[c] = model.inputWeight[(size_t) c] * buffers[s][t] + model.inputBias[(size_t) c];
+        }
+
+        for (int l = 0; l < numLayers; ++l)
+        {
+            const auto& layer = model.layers[(size_t) l];
+
+            for (int s = 0; s < numStreams; ++s)
+            {
+                if (t >= numSamples[s])
+                    continue;
+
+                auto& engine = *engines[s];
+                auto& state = engine.layerStates[(size_t) l];
+
+                std::copy (engine.frame.begin(), engine.frame.end(),
+                           state.ring.data() + (size_t) (engine.position & state.mask) * (size_t) C);
+
+                for (int k = 0; k < K; ++k)
+                {
+                    const int tap = (engine.position - (K - 1 - k) * state.dilation) & state.mask;
+                    taps[s * K + k] = state.ring.data() + (size_t) tap * (size_t) C;
+                }
+            }
+
+            for (int o = 0; o < C; ++o)
+            {
+                for (int s = 0; s < numStreams; ++s)
+                    z[s] = layer.convBias[(size_t) o];
+
+                for (int k = 0; k < K; ++k)
+                {
+                    const float* w = layer.convWeight.data() + ((size_t) k * (size_t) C + (size_t) o) * (size_t) C;
+
+                    for (int s = 0; s < numStreams; ++s)
+                    {
+                        if (t >= numSamples[s])
+                            continue;
+
+                        const float* past = taps[s * K + k];
+                        float sum = z[s];
+
+                        for (int i = 0; i < C; ++i)
+                            sum += w[i] * past[i];
+
+                        z[s] = sum;
+                    }
+                }
+
+                for (int s = 0; s < numStreams; ++s)
+                {
+                    if (t >= numSamples[s])
+                        continue;
+
+                    const float* layerFiLM = films[s] + (size_t) l * 2 * (size_t) C;
+                    const float* layerSlope = filmSlopes[s] != nullptr ? filmSlopes[s] + (size_t) l * 2 * (size_t) C : nullptr;
+                    engines[s]->activation[(size_t) o] = std::tanh (applyFiLM (z[s], layerFiLM, layerSlope, o, C, (float) t));
+                }
+            }
+
+            for (int o = 0; o < C; ++o)
+            {
+                const float* w = layer.mixWeight.data() + (size_t) o * (size_t) C;
+
+                for (int s = 0; s < numStreams; ++s)
+                {
+                    if (t >= numSamples[s])
+                        continue;
+
+                    const float* a = engines[s]->activation.data();
+                    float r = layer.mixBias[(size_t) o];
+
+                    for (int i = 0; i < C; ++i)
+                        r += w[i] * a[i];
+
+                    engines[s]->frame[(size_t) o] += r;
+                }
+            }
+        }
+
+        for (int s = 0; s < numStreams; ++s)
+        {
+            if (t >= numSamples[s])
+                continue;
+
+            auto& engine = *engines[s];
+            float y = model.outputBias;
+
+            for (int c = 0; c < C; ++c)
+                y += model.outputWeight[(size_t) c] * engine.frame[(size_t) c];
+
+            buffers[s][t] = y;
+            engine.position = (engine.position + 1) & engine.positionMask;
+        }
+    }
+}
+
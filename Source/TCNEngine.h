@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    TCNEngine.h
+    Real-time inference of the Prism TCN on a single band stream.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PrismModel.h"
+#include "TCNKernels.h"
+
+//==============================================================================
+/**
+    Runs a PrismModel causally on one audio stream, one sample at a time.
+
+    Every layer keeps its own circular history of input frames, sized to the next
+    power of two above (kernelSize - 1) * dilation, and persisting across blocks.
+    A new sample costs exactly one output frame per layer whatever the receptive
+    field, and nothing is shifted or recomputed between blocks. All memory is
+    allocated in prepare(); process() is safe to call on the audio thread.
+
+    Besides full fp32, the engine can run on the model's fp16 weights (accumulating
+    in fp32) or on its int8 weights, with the layer histories and activations
+    quantised to int8 as well. The kernels for both come from TCNKernels.
+*/
+class TCNEngine
+{
+public:
+    TCNEngine() = default;
+
+    /** Allocates the layer state for the given model. The model must outlive the engine.
+        maximumDilationScale reserves history for running at up to that multiple of the
+        model's sample rate (see setDilationScale).
+    */
+    void prepare (const PrismModel& model, int maximumBlockSize, int maximumDilationScale = 1);
+    void reset();
+
+    /** Runs the network at scale times its training rate by spreading every dilation by
+        the same factor, so the convolutions still span the same time. Clears the state;
+        allocation-free as long as scale <= the maximumDilationScale given to prepare().
+    */
+    void setDilationScale (int scale) noexcept;
+
+    using Precision = TCNKernels::Precision;
+
+    /** Selects the arithmetic used by process(). The layer histories are converted, so the
+        stream carries on without a reset; allocation-free. fp16 and int8 need the model's
+        reduced weights (PrismModel::prepareReducedWeights()).
+    */
+    void setPrecision (Precision newPrecision) noexcept;
+    Precision getPrecision() const noexcept         { return precision; }
+
+    /** Puts every layer history into the state an endless silent input would leave it in,
+        so a stream that was skipped while idle resumes without a cold-start transient.
+        Costs one sample plus writing the histories; allocation-free.
+    */
+    void settle (const float* film) noexcept;
+
+    /** Processes numSamples samples. film holds PrismModel::getFiLMSize() coefficients for the
+        first sample; filmSlope, if given, their change per sample (a conditioning ramp).
+    */
+    void process (const float* input, float* output, int numSamples, const float* film,
+                  const float* filmSlope = nullptr) noexcept;
+
+    bool isPrepared() const noexcept    { return model != nullptr; }
+
+    const PrismModel* getModel() const noexcept     { return model; }
+    int getDilationScale() const noexcept           { return dilationScale; }
+
+    //==============================================================================
+    /** Working memory of processBatch(), grown on demand by the calling thread. */
+    struct BatchScratch
+    {
+        std::vector<float> z;
+        std::vector<const float*> taps;
+    };
+
+    /** Runs several streams of the same model and dilation scale together. Each stream
+        is processed in place on buffers[s] for numSamples[s] samples, conditioned as by
+        process (..., films[s], filmSlopes[s]); slopes may be null.
+
+        Every weight row is loaded once per sample and applied to all the streams, so the
+        per-stream matrix-vector products become one small matrix-matrix product. The
+        arithmetic of each stream is the same as in process(), hence so are the results.
+        Streams must also share a precision; reduced-precision ones are run one by one.
+    */
+    static void processBatch (TCNEngine* const* engines, float* const* buffers, const float* const* films,
+                              const float* const* filmSlopes, const int* numSamples, int numStreams,
+                              BatchScratch& scratch);
+
+private:
+    struct LayerState
+    {
+        int dilation = 1;           // model dilation * dilation scale
+        int mask = 0;               // ring length - 1 (in frames)
+        std::vector<float> ring;    // capacity for the largest dilation scale
+        std::vector<juce::int8> ring8;      // int8 precision: [frame][int8Stride]
+        std::vector<float> ringScales;      // int8 precision: one scale per frame
+    };
+
+    void processFloat (const float* input, float* output, int numSamples, const float* film, const float* filmSlope) noexcept;
+    void processReduced (const float* input, float* output, int numSamples, const float* film, const float* filmSlope) noexcept;
+
+    const PrismModel* model = nullptr;
+    int maxDilationScale = 1;
+    int dilationScale = 1;
+    std::vector<LayerState> layerStates;
+    int position = 0;                   // write frame, shared by every layer ring
+    int positionMask = 0;               // mask of the longest ring, which every shorter one divides
+    Precision precision = Precision::fp32;
+    std::vector<float> frame, activation, convSums, residual;
+    std::vector<juce::int8> activation8;
+
+    JUCE_LEAK_DETECTOR (TCNEngine)
+};
@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    TCNKernels.cpp
+    Reduced-precision matrix-vector kernels with runtime CPU dispatch.
+
+  ==============================================================================
+*/
+
+#include "TCNKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+#endif
+
+// Lets one translation unit hold code for several instruction sets; MSVC needs no flag
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define PRISM_TARGET(isa) __attribute__ ((target (isa)))
+#else
+ #define PRISM_TARGET(isa)
+#endif
+
+//==============================================================================
+juce::uint16 TCNKernels::floatToHalf (float value) noexcept
+{
+    juce::uint32 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+
+    const auto sign = (juce::uint16) ((bits >> 16) & 0x8000);
+    const auto exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+    juce::uint32 mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff)                              // inf / nan
+        return (juce::uint16) (sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+
+    if (exponent >= 0x1f)                                           // overflow
+        return (juce::uint16) (sign | 0x7c00);
+
+    if (exponent <= 0)                                              // subnormal or zero
+    {
+        if (exponent < -10)
+            return sign;
+
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        auto half = mantissa >> shift;
+        const auto rest = mantissa & ((1u << shift) - 1);
+        const auto midpoint = 1u << (shift - 1);
+
+        if (rest > midpoint || (rest == midpoint && (half & 1) != 0))
+            ++half;
+
+        return (juce::uint16) (sign | half);
+    }
+
+    auto half = (juce::uint32) (exponent << 10) | (mantissa >> 13);
+    const auto rest = mantissa & 0x1fff;
+
+    // Round to nearest even; a carry into the exponent is the correct result
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+        ++half;
+
+    return (juce::uint16) (sign | half);
+}
+
+float TCNKernels::halfToFloat (juce::uint16 value) noexcept
+{
+    const juce::uint32 sign = (juce::uint32) (value & 0x8000) << 16;
+    juce::uint32 exponent = (value >> 10) & 0x1f;
+    juce::uint32 mantissa = value & 0x3ff;
+    juce::uint32 bits;
+
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // Subnormal half: normalise
+        exponent = 127 - 15 + 1;
+
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float result;
+    std::memcpy (&result, &bits, sizeof (result));
+    return result;
+}
+
+float TCNKernels::quantise (const float* x, juce::int8* q, int n) noexcept
+{
+    float maxAbs = 0.0f;
+
+    for (int i = 0; i < n; ++i)
+        maxAbs = juce::jmax (maxAbs, std::abs (x[i]));
+
+    if (maxAbs == 0.0f)
+    {
+        std::fill (q, q + n, (juce::int8) 0);
+        return 0.0f;
+    }
+
+    const float scale = maxAbs / 127.0f;
+    const float inverse = 127.0f / maxAbs;
+
+    for (int i = 0; i < n; ++i)
+        q[i] = (juce::int8) juce::jlimit (-127, 127, juce::roundToInt (x[i] * inverse));
+
+    return scale;
+}
+
+//==============================================================================
+namespace
+{
+    void matVecHalfScalar (const juce::uint16* w, const float* x, float* y, int rows, int cols)
+    {
+        for (int r = 0; r < rows; ++r, w += cols)
+        {
+            float sum = 0.0f;
+
+            for (int c = 0; c < cols; ++c)
+                sum += TCNKernels::halfToFloat (w[c]) * x[c];
+
+            y[r] += sum;
+        }
+    }
+
+    void matVecInt8Scalar (const juce::int8* w, const float* rowScales, const juce::int8* x, float xScale,
+                           float* y, int rows, int stride)
+    {
+        for (int r = 0; r < rows; ++r, w += stride)
+        {
+            juce::int32 sum = 0;
+
+            for (int c = 0; c < stride; ++c)
+                sum += (juce::int32) w[c] * (juce::int32) x[c];
+
+            y[r] += rowScales[r] * xScale * (float) sum;
+        }
+    }
+
+   #if JUCE_INTEL
+    PRISM_TARGET ("avx2,fma,f16c")
+    inline float horizontalSum (__m256 v)
+    {
+        auto s = _mm_add_ps (_mm256_castps256_ps128 (v), _mm256_extractf128_ps (v, 1));
+        s = _mm_add_ps (s, _mm_movehl_ps (s, s));
+        s = _mm_add_ss (s, _mm_shuffle_ps (s, s, 1));
+        return _mm_cvtss_f32 (s);
+    }
+
+    PRISM_TARGET ("avx2")
+    inline juce::int32 horizontalSum (__m256i v)
+    {
+        auto s = _mm_add_epi32 (_mm256_castsi256_si128 (v), _mm256_extracti128_si256 (v, 1));
+        s = _mm_add_epi32 (s, _mm_shuffle_epi32 (s, _MM_SHUFFLE (1, 0, 3, 2)));
+        s = _mm_add_epi32 (s, _mm_shuffle_epi32 (s, _MM_SHUFFLE (2, 3, 0, 1)));
+        return _mm_cvtsi128_si32 (s);
+    }
+
+    PRISM_TARGET ("avx2,fma,f16c")
+    void matVecHalfAVX2 (const juce::uint16* w, const float* x, float* y, int rows, int cols)
+    {
+        const int vectorCols = cols & ~7;
+
+        for (int r = 0; r < rows; ++r, w += cols)
+        {
+            auto acc = _mm256_setzero_ps();
+
+            for (int c = 0; c < vectorCols; c += 8)
+            {
+                const auto weights = _mm256_cvtph_ps (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (w + c)));
+                acc = _mm256_fmadd_ps (weights, _mm256_loadu_ps (x + c), acc);
+            }
+
+            float sum = horizontalSum (acc);
+
+            for (int c = vectorCols; c < cols; ++c)
+                sum += TCNKernels::halfToFloat (w[c]) * x[c];
+
+            y[r] += sum;
+        }
+    }
+
+    // maddubs multiplies unsigned by signed bytes: move the sign of x onto w
+    PRISM_TARGET ("avx2")
+    void matVecInt8AVX2 (const juce::int8* w, const float* rowScales, const juce::int8* x, float xScale,
+                         float* y, int rows, int stride)
+    {
+        const auto ones = _mm256_set1_epi16 (1);
+
+        for (int r = 0; r < rows; ++r, w += stride)
+        {
+            auto acc = _mm256_setzero_si256();
+
+            for (int c = 0; c < stride; c += TCNKernels::int8Alignment)
+            {
+                const auto xv = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (x + c));
+                const auto wv = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (w + c));
+                const auto products = _mm256_maddubs_epi16 (_mm256_sign_epi8 (xv, xv), _mm256_sign_epi8 (wv, xv));
+                acc = _mm256_add_epi32 (acc, _mm256_madd_epi16 (products, ones));
+            }
+
+            y[r] += rowScales[r] * xScale * (float) horizontalSum (acc);
+        }
+    }
+
+    // vpdpbusd accumulates straight into int32, without the 16-bit intermediate
+    PRISM_TARGET ("avx2,avx512f,avx512vl,avx512vnni")
+    void matVecInt8VNNI (const juce::int8* w, const float* rowScales, const juce::int8* x, float xScale,
+                         float* y, int rows, int stride)
+    {
+        for (int r = 0; r < rows; ++r, w += stride)
+        {
+            auto acc = _mm256_setzero_si256();
+
+            for (int c = 0; c < stride; c += TCNKernels::int8Alignment)
+            {
+                const auto xv = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (x + c));
+                const auto wv = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (w + c));
+                acc = _mm256_dpbusd_epi32 (acc, _mm256_sign_epi8 (xv, xv), _mm256_sign_epi8 (wv, xv));
+            }
+
+            y[r] += rowScales[r] * xScale * (float) horizontalSum (acc);
+        }
+    }
+
+    void cpuid (int leaf, int subleaf, juce::uint32 (&registers)[4])
+    {
+       #if JUCE_MSVC
+        int r[4];
+        __cpuidex (r, leaf, subleaf);
+        for (int i = 0; i < 4; ++i)
+            registers[i] = (juce::uint32) r[i];
+       #else
+        __cpuid_count (leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+       #endif
+    }
+
+    bool hasF16C()
+    {
+        juce::uint32 r[4];
+        cpuid (1, 0, r);
+        return (r[2] & (1u << 29)) != 0;
+    }
+
+    /** XCR0: the register state the OS saves on context switches, without which the wider
+        registers cannot be used whatever CPUID says (e.g. under some hypervisors).
+    */
+    juce::uint64 getEnabledRegisterState()
+    {
+        juce::uint32 r[4];
+        cpuid (1, 0, r);
+
+        if ((r[2] & (1u << 27)) == 0)   // OSXSAVE
+            return 0;
+
+       #if JUCE_MSVC
+        return (juce::uint64) _xgetbv (0);
+       #else
+        juce::uint32 low, high;
+        __asm__ __volatile__ ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+        return ((juce::uint64) high << 32) | low;
+       #endif
+    }
+
+    // XMM and YMM (bits 1-2), plus opmask and ZMM (bits 5-7) for the EVEX-encoded kernels
+    constexpr juce::uint64 avxState = 0x06, avx512State = 0xe6;
+
+    bool hasAVX512VNNI()
+    {
+        juce::uint32 r[4];
+        cpuid (0, 0, r);
+
+        if (r[0] < 7)
+            return false;
+
+        cpuid (7, 0, r);
+        return (r[2] & (1u << 11)) != 0;
+    }
+   #endif
+
+    TCNKernels selectKernels()
+    {
+       #if JUCE_INTEL
+        using Stats = juce::SystemStats;
+
+        const auto registerState = getEnabledRegisterState();
+
+        if (Stats::hasAVX2() && Stats::hasFMA3() && hasF16C() && (registerState & avxState) == avxState)
+        {
+            if (Stats::hasAVX512F() && Stats::hasAVX512VL() && hasAVX512VNNI() && (registerState & avx512State) == avx512State)
+                return { matVecHalfAVX2, matVecInt8VNNI, "avx512-vnni" };
+
+            return { matVecHalfAVX2, matVecInt8AVX2, "avx2" };
+        }
+       #endif
+
+        return { matVecHalfScalar, matVecInt8Scalar, "scalar" };
+    }
+}
+
+const TCNKernels& TCNKernels::get()
+{
+    static const TCNKernels kernels = selectKernels();
+    return kernels;
+}
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    TCNKernels.h
+    Reduced-precision matrix-vector kernels with runtime CPU dispatch.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The inner products of the fp16 and int8 quality modes of the TCN.
+
+    fp16 weights are widened to fp32 and accumulated in fp32. int8 weights carry
+    one scale per row and are multiplied with int8-quantised activations (one
+    scale per vector), accumulating in int32; int8 rows and vectors are padded
+    with zeros to a multiple of int8Alignment values.
+
+    get() picks the best implementation for the running CPU once: AVX-512 VNNI,
+    AVX2 (with F16C and FMA), or portable scalar code.
+*/
+struct TCNKernels
+{
+    enum class Precision { fp32, fp16, int8 };
+
+    static constexpr int int8Alignment = 32;
+
+    /** y[r] += sum_c w[r * cols + c] * x[c] */
+    using MatVecHalf = void (*) (const juce::uint16* w, const float* x, float* y, int rows, int cols);
+
+    /** y[r] += rowScales[r] * xScale * sum_c w[r * stride + c] * x[c]   (stride is a multiple of int8Alignment) */
+    using MatVecInt8 = void (*) (const juce::int8* w, const float* rowScales, const juce::int8* x, float xScale,
+                                 float* y, int rows, int stride);
+
+    MatVecHalf matVecHalf;
+    MatVecInt8 matVecInt8;
+    const char* name;
+
+    static const TCNKernels& get();
+
+    static int getInt8Stride (int numValues) noexcept
+    {
+        return (numValues + int8Alignment - 1) / int8Alignment * int8Alignment;
+    }
+
+    static juce::uint16 floatToHalf (float value) noexcept;
+    static float halfToFloat (juce::uint16 value) noexcept;
+
+    /** Quantises n values symmetrically to int8 and returns the scale (0 for a zero vector).
+        The padding up to the stride is left untouched, so it must be zero already.
+    */
+    static float quantise (const float* x, juce::int8* q, int n) noexcept;
+};
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    WorkerPool.cpp
+    Real-time safe fork/join pool for splitting a block across cores.
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    inline void cpuRelax() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+
+    // claim = generation << 32 | numTasks << 16 | next task
+    inline juce::uint32 getGeneration (juce::uint64 claim) noexcept     { return (juce::uint32) (claim >> 32); }
+    inline int getNumTasks (juce::uint64 claim) noexcept                { return (int) ((claim >> 16) & 0xffff); }
+    inline int getNextTask (juce::uint64 claim) noexcept                { return (int) (claim & 0xffff); }
+
+    // How long a helper keeps polling for the next job before it sleeps: a few blocks' worth of
+    // wake-up latency saved, at the cost of a short busy wait after every job
+    constexpr double spinSeconds = 0.0002;
+}
+
+//==============================================================================
+class WorkerPool::Worker  : public juce::Thread
+{
+public:
+    explicit Worker (WorkerPool& p)
+        : juce::Thread ("Prism worker"), pool (p)
+    {
+        // The helpers do the audio thread's work, so they get its scheduling class where allowed
+        if (! startRealtimeThread (juce::Thread::RealtimeOptions{}.withPriority (10)))
+            startThread (juce::Thread::Priority::highest);
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        pool.parking.wakeAll (pool.wakeWord, maxWorkers);
+        stopThread (1000);
+    }
+
+private:
+    void run() override
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        auto seen = getGeneration (pool.claim.load (std::memory_order_acquire));
+        const auto spinTicks = (juce::int64) (spinSeconds * (double) juce::Time::getHighResolutionTicksPerSecond());
+
+        while (! threadShouldExit())
+        {
+            const auto spinDeadline = juce::Time::getHighResolutionTicks() + spinTicks;
+            auto generation = seen;
+
+            while ((generation = getGeneration (pool.claim.load (std::memory_order_acquire))) == seen)
+            {
+                if (threadShouldExit())
+                    return;
+
+                if (juce::Time::getHighResolutionTicks() < spinDeadline)
+                {
+                    cpuRelax();
+                    continue;
+                }
+
+                // Announce the sleep before the kernel's check of the word, so that run() either
+                // sees a sleeper to wake or published its job before that check
+                ++pool.numSleeping;
+                pool.parking.wait (pool.wakeWord, seen, 100);
+                --pool.numSleeping;
+            }
+
+            seen = generation;
+
+            while (pool.performTask (generation))
+            {
+            }
+        }
+    }
+
+    WorkerPool& pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+WorkerPool::WorkerPool() = default;
+
+WorkerPool::~WorkerPool()
+{
+    for (auto& worker : workers)
+        worker.reset();
+}
+
+void WorkerPool::prepare (int numWanted)
+{
+    const juce::ScopedLock sl (prepareLock);
+
+    numWanted = juce::jlimit (0, juce::jmin (maxWorkers, juce::SystemStats::getNumCpus() - 1), numWanted);
+
+    // Published one at a time: run() only ever sees helpers that are already started
+    for (int i = numWorkers.load(); i < numWanted; ++i)
+    {
+        workers[(size_t) i] = std::make_unique<Worker> (*this);
+        numWorkers.store (i + 1, std::memory_order_release);
+    }
+}
+
+bool WorkerPool::performTask (juce::uint32 generation) noexcept
+{
+    auto current = claim.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        if (getGeneration (current) != generation || getNextTask (current) >= getNumTasks (current))
+            return false;
+
+        // The job cannot be replaced while a claimed task is unfinished, so its fields are stable
+        if (claim.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            jobCallback (jobContext, getNextTask (current));
+            unfinished.fetch_sub (1, std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+void WorkerPool::runTasks (int numTasks, TaskCallback callback, void* context) noexcept
+{
+    jassert (numTasks <= 0xffff);
+
+    // Another caller's job is in flight: rather than wait for it, do the work here
+    if (numTasks <= 1 || getNumWorkers() == 0 || busy.exchange (true, std::memory_order_acquire))
+    {
+        for (int i = 0; i < numTasks; ++i)
+            callback (context, i);
+
+        return;
+    }
+
+    jobCallback = callback;
+    jobContext = context;
+    unfinished.store (numTasks, std::memory_order_relaxed);
+
+    const auto generation = getGeneration (claim.load (std::memory_order_relaxed)) + 1;
+    claim.store (((juce::uint64) generation << 32) | ((juce::uint64) numTasks << 16));
+    wakeWord.store (generation);
+
+    if (const int sleepers = numSleeping.load(); sleepers > 0)
+        parking.wakeAll (wakeWord, sleepers);
+
+    // The caller never waits for a helper to start: whatever is left, it does itself
+    while (performTask (generation))
+    {
+    }
+
+    while (unfinished.load (std::memory_order_acquire) > 0)
+        cpuRelax();
+
+    busy.store (false, std::memory_order_release);
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+    Real-time safe fork/join pool for splitting a block across cores.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Parking.h"
+
+//==============================================================================
+/**
+    A small set of helper threads that audio threads can hand independent tasks
+    to (e.g. one per band network) and join within the same block.
+
+    run() publishes the tasks and then works through them itself: a helper only
+    takes a task that nobody has started, so the audio thread never waits for a
+    helper to wake up, only for tasks already running elsewhere to finish. The
+    helpers are real-time threads where the system allows it. They spin for a
+    short while after a job and then sleep on a futex (WaitOnAddress on Windows,
+    a semaphore elsewhere), so jobs arriving every block normally find them
+    awake, and waking the others is a single system call.
+
+    One pool is meant to serve the whole process (use it through a
+    juce::SharedResourcePointer), so that the number of helpers is bounded by the
+    cores rather than by the number of plugin instances. It runs one job at a
+    time: a run() that finds the helpers busy with another caller's job does its
+    tasks itself. run() allocates nothing and takes no lock.
+*/
+class WorkerPool
+{
+public:
+    static constexpr int maxWorkers = 15;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    /** Starts helper threads until there are at least numWorkers of them, clamped to the
+        cores left besides the caller's. The pool never shrinks while in use, since other
+        callers may be relying on its helpers. Not for the audio thread.
+    */
+    void prepare (int numWorkers);
+
+    int getNumWorkers() const noexcept          { return numWorkers.load (std::memory_order_acquire); }
+
+    /** Calls task (i) for every i in [0, numTasks) across the caller and the helpers and
+        returns when all calls have returned. task must be safe to call concurrently for
+        different indices.
+    */
+    template <typename TaskFunction>
+    void run (int numTasks, TaskFunction& task) noexcept
+    {
+        runTasks (numTasks, [] (void* context, int index) { (*static_cast<TaskFunction*> (context)) (index); }, &task);
+    }
+
+private:
+    using TaskCallback = void (*) (void* context, int index);
+
+    class Worker;
+
+    void runTasks (int numTasks, TaskCallback callback, void* context) noexcept;
+    bool performTask (juce::uint32 generation) noexcept;
+
+    Parking parking;                        // where idle helpers sleep
+    juce::CriticalSection prepareLock;      // prepare() vs. prepare(), never on the audio thread
+    std::array<std::unique_ptr<Worker>, maxWorkers> workers;
+    std::atomic<int> numWorkers { 0 };
+    std::atomic<bool> busy { false };       // a caller owns the job fields below
+
+    // The job in flight. claim packs the job's generation with its size and next unclaimed
+    // task, so a late helper can never take a task of a newer job.
+    TaskCallback jobCallback = nullptr;
+    void* jobContext = nullptr;
+    std::atomic<juce::uint64> claim { 0 };
+    std::atomic<int> unfinished { 0 };
+    std::atomic<int> numSleeping { 0 };
+    std::atomic<juce::uint32> wakeWord { 0 };       // the job's generation, what sleeping helpers wait on
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
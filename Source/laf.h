@@ -6,10 +6,45 @@
 #include <juce_graphics/juce_graphics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
 #include <cmath>
+#include <map>
+#include <tuple>
 
 class MBDistLaF : public juce::LookAndFeel_V4
 {
     std::unique_ptr<juce::Drawable> sldback_svd_drawable, sldcur_svd_drawable;
+
+    // Pre-rendered control graphics, keyed by what they show, their size in physical pixels
+    // (so the editor scale, the slider transforms and the display scale are all accounted for)
+    // and whatever else render depends on, such as the colours it draws with
+    enum class Sprite { sliderBack, sliderCursor, knobBody };
+    std::map<std::tuple<Sprite, int, int, juce::uint64>, juce::Image> sprites;
+
+    /** Draws a cached image of render's output in area, rendering it on first use at this size.
+        variant must tell apart renders that differ other than in size, e.g. by colour.
+    */
+    template <typename RenderFunction>
+    void drawSprite (Graphics& g, Sprite sprite, Rectangle<float> area, RenderFunction&& render, juce::uint64 variant = 0)
+    {
+        if (area.isEmpty())
+            return;
+
+        const float pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const int w = jmax (1, roundToInt (area.getWidth() * pixelScale));
+        const int h = jmax (1, roundToInt (area.getHeight() * pixelScale));
+
+        auto& image = sprites[std::make_tuple (sprite, w, h, variant)];
+
+        if (image.isNull())
+        {
+            image = Image (Image::ARGB, w, h, true);
+            Graphics sg (image);
+            sg.addTransform (AffineTransform::scale ((float) w / area.getWidth(), (float) h / area.getHeight()));
+            render (sg, area.withZeroOrigin());
+        }
+
+        g.drawImage (image, area);
+    }
+
 public:    
     // Use Arial as main font
     // juce::Font mainFont{ "Arial", 20.0f, juce::Font::bold };
@@ -41,6 +76,14 @@ public:
         this->setColour(juce::Slider::rotarySliderOutlineColourId, juce::Colours::darkgrey);
     }
 
+    /** Drops the cached control images. The editor calls this when it is resized, since
+        every control then needs them at a new size.
+    */
+    void clearSpriteCache()
+    {
+        sprites.clear();
+    }
+
     /**
      * tHIS SETS the offset from top and bottom for both the thumb and background drawn in drawLinearSlider
      */
@@ -87,7 +130,10 @@ public:
                                                      static_cast<float> (y) - backgroundTopMargin, 
                                                      static_cast<float> (width), 
                                                      static_cast<float> (height) + backgroundTopMargin + backgroundBottomMargin);
-                sldback_svd_drawable->drawWithin(g, svgBackRect, juce::RectanglePlacement::stretchToFit , 1.0f);
+                drawSprite (g, Sprite::sliderBack, svgBackRect, [this] (Graphics& sg, Rectangle<float> r)
+                {
+                    sldback_svd_drawable->drawWithin(sg, r, juce::RectanglePlacement::stretchToFit , 1.0f);
+                });
 
                 // g.setColour(juce::Colours::green);
                 // g.drawRect(x, y, width, height);
@@ -134,7 +180,10 @@ public:
                     // juce::Rectangle<float> svgCurRect(maxPoint.x, maxPoint.y, thumbWidth, thumbHeight);
                     // juce::Rectangle<float> svgCurRect (static_cast<float> (thumbWidth), static_cast<float> (thumbHeight)).withCentre (isThreeVal ? thumbPoint : maxPoint);
                     juce::Rectangle<float> svgCurRect = juce::Rectangle<float>(static_cast<float> (thumbWidth), static_cast<float> (thumbHeight)).withCentre (isThreeVal ? thumbPoint : maxPoint);
-                    sldcur_svd_drawable->drawWithin(g, svgCurRect, juce::RectanglePlacement::stretchToFit , 1.0f);
+                    drawSprite (g, Sprite::sliderCursor, svgCurRect, [this] (Graphics& sg, Rectangle<float> r)
+                    {
+                        sldcur_svd_drawable->drawWithin(sg, r, juce::RectanglePlacement::stretchToFit , 1.0f);
+                    });
                 }
             }
 
@@ -206,10 +255,18 @@ public:
                                     bounds.getCentreY() - size * 0.5f,
                                     size, size);
         // auto background = slider.findColour (Slider::backgroundColourId);
-        g.setColour (fill);
-        g.fillEllipse (barBounds);
-        g.setColour (outline);
-        g.drawEllipse (barBounds, lineW);
+        // The knob body is the same for every knob of a size and colours: cached, only the
+        // indicator is drawn live
+        const auto colours = ((juce::uint64) fill.getARGB() << 32) | outline.getARGB();
+
+        drawSprite (g, Sprite::knobBody, bounds, [&] (Graphics& sg, Rectangle<float>)
+        {
+            const auto body = barBounds - bounds.getPosition();
+            sg.setColour (fill);
+            sg.fillEllipse (body);
+            sg.setColour (outline);
+            sg.drawEllipse (body, lineW);
+        }, colours);
         if (slider.isEnabled())
         {
             Point<float> thumbPoint (bounds.getCentreX() + arcRadius * std::cos (toAngle - MathConstants<float>::halfPi),
@@ -0,0 +1,759 @@
+/*
+  ==============================================================================
+
+    AccuracyBench.cpp
+    Accuracy-versus-speed regression bench against reference renders.
+
+    Renders a corpus of dry files through MBDistProcessor in every requested
+    processing mode (precision, oversampling, model tier) and compares the
+    results with reference renders of the Python model. Each case reports the
+    error-to-signal ratio and log-spectral distance next to the real-time
+    factor; the exit code is 2 if any case crosses a threshold, so the bench
+    can gate a build, and 77 (skipped, to CTest) when there is no model.
+
+    Each precision has its own thresholds, real-time factor included. References in a lossy format (the
+    MP3s of docs/demos) carry codec error and delay of their own, so they are
+    aligned by a lag search, compared below the encoder's low-pass, and given
+    a margin on top of the thresholds.
+
+    The corpus uses the layout of docs/demos: dry/<source>.<ext> and
+    wet/<source>_B0PfG5T5_..._B7PkG1T1.<ext>, where each band reads
+    B<band>P<pedal>G<gain>T<tone>, pedal r (Distortion), f (Fuzz) or
+    k (Overdrive), gain and tone 0 to 5 (parameter values 0 to 10).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+namespace
+{
+    /** Pass/fail limits for one precision. */
+    struct Thresholds
+    {
+        double maxEsr;
+        double maxSpectralDistance;                      // dB
+        double minRealtimeFactor;
+    };
+
+    struct Options
+    {
+        juce::File corpus = juce::File::getCurrentWorkingDirectory().getChildFile ("docs/demos");
+        juce::File modelFile;                            // empty: default model
+        juce::File outputFile;                           // empty: stdout
+        juce::Array<int> qualities { 0, 1, 2 };          // indices into MBDistProcessor::qualityModes
+        juce::Array<int> oversampling { 0 };             // indices into MBDistProcessor::oversamplingFactors
+        juce::Array<int> tiers { 0, 1 };                 // indices into MBDistProcessor::modelTiers
+        int blockSize = 512;
+        double seconds = 10.0;                           // compared audio per file, 0 for all of it
+        int maxLag = -1;                                 // alignment search, -1: lossyMaxLag for lossy references only
+        std::array<Thresholds, 3> thresholds { { { 0.05, 3.0, 1.0 }, { 0.06, 3.0, 1.0 }, { 0.12, 4.5, 1.0 } } };  // fp32, fp16, int8
+        Thresholds lossyMargin { 0.05, 2.0, 0.0 };       // added for lossy references
+    };
+
+    // Covers the encoder and decoder delay of MP3 (about 1100 samples) and AAC
+    constexpr int lossyMaxLag = 2048;
+
+    // Common MP3/AAC encoders low-pass at 16 kHz and above
+    constexpr double lossyMaxFrequency = 16000.0;
+
+    // What CTest treats as a skipped test (SKIP_RETURN_CODE)
+    constexpr int skippedExitCode = 77;
+
+    bool isLossless (const juce::File& file)
+    {
+        return file.hasFileExtension ("wav;aif;aiff;flac");
+    }
+
+    void printUsage()
+    {
+        std::cerr
+            << "Usage: PrismAccuracy [options]\n"
+               "\n"
+               "  --corpus <dir>            Folder with dry/ and wet/ renders (default: docs/demos)\n"
+               "  --quality <name,...>      Network precision: fp32, fp16, int8 (default: all)\n"
+               "  --oversampling <1,2,...>  Oversampling factors (default: 1)\n"
+               "  --tiers <name,...>        Model tiers: full, live (default: both)\n"
+               "  --block <n>               Processing block size (default: 512)\n"
+               "  --seconds <s>             Audio compared per file, 0 for all (default: 10)\n"
+               "  --max-lag <n>             Search +/- n samples for the best alignment\n"
+               "                            (default: 2048 for lossy references, else 0)\n"
+               "  --max-esr <x|mode=x,...>  Fail above this error-to-signal ratio, for every precision or\n"
+               "                            per precision (default: fp32=0.05,fp16=0.06,int8=0.12)\n"
+               "  --max-lsd <dB|mode=dB,...>  Fail above this log-spectral distance\n"
+               "                            (default: fp32=3,fp16=3,int8=4.5)\n"
+               "  --lossy-margin <x,dB>     Added to both for lossy references (default: 0.05,2)\n"
+               "  --min-rtf <x|mode=x,...>  Fail below this real-time factor (default: fp32=1,fp16=1,int8=1)\n"
+               "  -m, --model <file>        Model file (default: installed model)\n"
+               "  -o, --output <file>       Write the JSON report to a file instead of stdout\n"
+               "\n"
+               "Exit code: 0 if every case is within the thresholds, 2 if not, 77 if there is no model\n"
+               "to test, 1 on other errors.\n";
+    }
+
+    juce::StringArray splitList (const juce::String& text)
+    {
+        return juce::StringArray::fromTokens (text, ",", "");
+    }
+
+    // Command-line names of MBDistProcessor::qualityModes, in the same order
+    const juce::StringArray& getQualityNames()
+    {
+        static const juce::StringArray names { "fp32", "fp16", "int8" };
+        return names;
+    }
+
+    bool parseIndices (const juce::String& list, const juce::StringArray& names, juce::Array<int>& indices)
+    {
+        indices.clear();
+
+        for (auto& token : splitList (list))
+        {
+            const int index = names.indexOf (token.trim(), true);
+
+            if (index < 0)
+                return false;
+
+            indices.add (index);
+        }
+
+        return ! indices.isEmpty();
+    }
+
+    /** Parses "x" (every precision) or "fp32=x,int8=y" into one limit of the thresholds. */
+    bool parseThresholds (const juce::String& list, std::array<Thresholds, 3>& thresholds, double Thresholds::* limit)
+    {
+        const auto tokens = splitList (list);
+
+        if (tokens.size() == 1 && ! tokens[0].containsChar ('='))
+        {
+            if (! tokens[0].trim().containsOnly ("0123456789."))
+                return false;
+
+            for (auto& t : thresholds)
+                t.*limit = tokens[0].getDoubleValue();
+
+            return true;
+        }
+
+        for (auto& token : tokens)
+        {
+            const int quality = getQualityNames().indexOf (token.upToFirstOccurrenceOf ("=", false, false).trim(), true);
+            const auto value = token.fromFirstOccurrenceOf ("=", false, false).trim();
+
+            if (quality < 0 || value.isEmpty() || ! value.containsOnly ("0123456789."))
+                return false;
+
+            thresholds[(size_t) quality].*limit = value.getDoubleValue();
+        }
+
+        return ! tokens.isEmpty();
+    }
+
+    bool parseOptions (const juce::StringArray& args, Options& options, juce::String& error)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            auto next = [&] { return i + 1 < args.size() ? args[++i] : juce::String(); };
+
+            if (arg == "--quality")
+            {
+                if (! parseIndices (next(), getQualityNames(), options.qualities))
+                {
+                    error = "Quality must be fp32, fp16 or int8";
+                    return false;
+                }
+            }
+            else if (arg == "--oversampling")
+            {
+                options.oversampling.clear();
+                for (auto& token : splitList (next()))
+                {
+                    const int index = MBDistProcessor::oversamplingFactors.indexOf (token.trim() + "x");
+
+                    if (index < 0)
+                    {
+                        error = "Oversampling must be 1, 2, 4 or 8";
+                        return false;
+                    }
+
+                    options.oversampling.add (index);
+                }
+            }
+            else if (arg == "--tiers")
+            {
+                if (! parseIndices (next(), MBDistProcessor::modelTiers, options.tiers))
+                {
+                    error = "Tiers must be full or live";
+                    return false;
+                }
+            }
+            else if (arg == "--corpus")                    options.corpus = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else if (arg == "--block")                     options.blockSize = juce::jlimit (16, 65536, next().getIntValue());
+            else if (arg == "--seconds")                   options.seconds = juce::jmax (0.0, next().getDoubleValue());
+            else if (arg == "--max-lag")                   options.maxLag = juce::jlimit (0, 48000, next().getIntValue());
+            else if (arg == "--max-esr" || arg == "--max-lsd" || arg == "--min-rtf")
+            {
+                const auto limit = arg == "--max-esr" ? &Thresholds::maxEsr
+                                 : arg == "--max-lsd" ? &Thresholds::maxSpectralDistance
+                                                      : &Thresholds::minRealtimeFactor;
+
+                if (! parseThresholds (next(), options.thresholds, limit))
+                {
+                    error = "Expected a value or fp32=<x>,fp16=<x>,int8=<x> after " + arg;
+                    return false;
+                }
+            }
+            else if (arg == "--lossy-margin")
+            {
+                const auto values = splitList (next());
+
+                if (values.size() != 2)
+                {
+                    error = "Expected <esr>,<dB> after " + arg;
+                    return false;
+                }
+
+                options.lossyMargin = { values[0].getDoubleValue(), values[1].getDoubleValue(), 0.0 };
+            }
+            else if (arg == "-m" || arg == "--model")      options.modelFile = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else if (arg == "-o" || arg == "--output")     options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else
+            {
+                error = "Unknown option: " + arg;
+                return false;
+            }
+        }
+
+        if (options.oversampling.isEmpty())
+        {
+            error = "Nothing to measure";
+            return false;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    /** A reference render and the dry file and band settings it was made from. */
+    struct CorpusItem
+    {
+        juce::String name;
+        juce::File dry, wet;
+        std::array<ConditioningCache::Settings, NUM_BANDS> bands;
+    };
+
+    /** Reads B<band>P<pedal>G<gain>T<tone> for every band from a reference file name. */
+    bool parseBandSettings (const juce::String& name, std::array<ConditioningCache::Settings, NUM_BANDS>& bands)
+    {
+        // Pedal letters of the training data, in the order of MBDistProcessor::bandEffects
+        const juce::String pedals ("rfk");
+
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            const auto tag = "B" + juce::String (band) + "P";
+            const int pos = name.indexOf (tag);
+
+            if (pos < 0)
+                return false;
+
+            const auto code = name.substring (pos + tag.length(), pos + tag.length() + 5);  // e.g. fG5T5
+            const int effect = pedals.indexOfChar (code[0]);
+
+            if (effect < 0 || code[1] != 'G' || code[3] != 'T'
+                 || ! juce::CharacterFunctions::isDigit (code[2]) || ! juce::CharacterFunctions::isDigit (code[4]))
+                return false;
+
+            auto& settings = bands[(size_t) band];
+            settings.effect = effect;
+            settings.gain = 2.0f * (float) (code[2] - '0');
+            settings.tone = 2.0f * (float) (code[4] - '0');
+        }
+
+        return true;
+    }
+
+    juce::Array<CorpusItem> findCorpus (const juce::File& corpus, juce::AudioFormatManager& formats)
+    {
+        juce::Array<CorpusItem> items;
+        const auto dryFolder = corpus.getChildFile ("dry");
+        const auto wildcards = formats.getWildcardForAllFormats();
+
+        for (auto& wet : corpus.getChildFile ("wet").findChildFiles (juce::File::findFiles, false, wildcards))
+        {
+            const auto name = wet.getFileNameWithoutExtension();
+            const auto source = name.upToFirstOccurrenceOf ("_B0P", false, false);
+            CorpusItem item;
+
+            if (source == name || ! parseBandSettings (name, item.bands))
+            {
+                std::cerr << "Skipping " << wet.getFileName() << ": no band settings in the name" << std::endl;
+                continue;
+            }
+
+            item.name = name;
+            item.wet = wet;
+
+            for (auto& dry : dryFolder.findChildFiles (juce::File::findFiles, false, source + ".*"))
+                if (formats.findFormatForFileExtension (dry.getFileExtension()) != nullptr)
+                    item.dry = dry;
+
+            if (item.dry == juce::File())
+            {
+                std::cerr << "Skipping " << wet.getFileName() << ": no dry file for " << source << std::endl;
+                continue;
+            }
+
+            items.add (item);
+        }
+
+        return items;
+    }
+
+    bool readFile (juce::AudioFormatManager& formats, const juce::File& file, juce::AudioBuffer<float>& buffer,
+                   double& sampleRate, int maxLength)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return false;
+
+        const int length = (int) juce::jmin ((juce::int64) maxLength, reader->lengthInSamples);
+        sampleRate = reader->sampleRate;
+        buffer.setSize ((int) reader->numChannels, length);
+        return reader->read (&buffer, 0, length, 0, true, true);
+    }
+
+    //==============================================================================
+    /** Sum over channels of (reference - output)^2 over the energy of the reference, for the
+        reference samples in [start, end).
+    */
+    double errorToSignalRatio (const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& output, int lag,
+                               int start = 0, int end = std::numeric_limits<int>::max())
+    {
+        double error = 0.0, energy = 0.0;
+        const int from = juce::jmax (start, -lag);
+        const int to = juce::jmin (end, reference.getNumSamples(), output.getNumSamples() - lag);
+
+        for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+        {
+            const float* ref = reference.getReadPointer (ch);
+            const float* out = output.getReadPointer (ch);
+
+            for (int i = from; i < to; ++i)
+            {
+                const double diff = (double) ref[i] - (double) out[i + lag];
+                error += diff * diff;
+                energy += (double) ref[i] * (double) ref[i];
+            }
+        }
+
+        return error / juce::jmax (energy, 1.0e-20);
+    }
+
+    /** RMS difference of the log power spectra (dB) up to maxFrequency, averaged over
+        Hann-windowed frames that are not silent in the reference.
+    */
+    double logSpectralDistance (const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& output, int lag,
+                                double sampleRate, double maxFrequency)
+    {
+        constexpr int fftOrder = 11, fftSize = 1 << fftOrder, hop = fftSize / 4;
+        constexpr float floorPower = 1.0e-10f;
+
+        juce::dsp::FFT fft (fftOrder);
+        juce::dsp::WindowingFunction<float> window ((size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false);
+        std::vector<float> refFrame (2 * fftSize), outFrame (2 * fftSize);
+
+        double total = 0.0;
+        int numFrames = 0;
+        const int length = juce::jmin (reference.getNumSamples(), output.getNumSamples() - lag) - juce::jmax (0, -lag);
+        const int numBins = juce::jlimit (1, fftSize / 2 + 1, (int) (maxFrequency / sampleRate * fftSize) + 1);
+
+        for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+        {
+            for (int start = juce::jmax (0, -lag); start + fftSize <= juce::jmax (0, -lag) + length; start += hop)
+            {
+                std::fill (refFrame.begin(), refFrame.end(), 0.0f);
+                std::fill (outFrame.begin(), outFrame.end(), 0.0f);
+                std::copy_n (reference.getReadPointer (ch, start), fftSize, refFrame.begin());
+                std::copy_n (output.getReadPointer (ch, start + lag), fftSize, outFrame.begin());
+
+                window.multiplyWithWindowingTable (refFrame.data(), (size_t) fftSize);
+                window.multiplyWithWindowingTable (outFrame.data(), (size_t) fftSize);
+                fft.performFrequencyOnlyForwardTransform (refFrame.data());
+                fft.performFrequencyOnlyForwardTransform (outFrame.data());
+
+                double refEnergy = 0.0, sum = 0.0;
+
+                for (int bin = 0; bin < numBins; ++bin)
+                {
+                    const float refPower = refFrame[(size_t) bin] * refFrame[(size_t) bin];
+                    const float outPower = outFrame[(size_t) bin] * outFrame[(size_t) bin];
+                    const double diff = 10.0 * std::log10 ((refPower + floorPower) / (outPower + floorPower));
+
+                    refEnergy += refPower;
+                    sum += diff * diff;
+                }
+
+                // Silence would compare noise floors
+                if (refEnergy < 1.0e-6)
+                    continue;
+
+                total += std::sqrt (sum / numBins);
+                ++numFrames;
+            }
+        }
+
+        return numFrames > 0 ? total / numFrames : 0.0;
+    }
+
+    /** The offset of the output within +/- maxLag samples that gives the smallest error,
+        searched on the loudest window of the reference to keep wide searches affordable.
+    */
+    int findBestLag (const juce::AudioBuffer<float>& reference, const juce::AudioBuffer<float>& output, int maxLag,
+                     int windowLength)
+    {
+        const int length = reference.getNumSamples();
+        windowLength = juce::jmin (windowLength, length);
+        int start = 0;
+        float loudest = -1.0f;
+
+        for (int pos = 0; pos + windowLength <= length; pos += juce::jmax (1, windowLength / 2))
+        {
+            float energy = 0.0f;
+
+            for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+                energy += reference.getRMSLevel (ch, pos, windowLength);
+
+            if (energy > loudest)
+            {
+                loudest = energy;
+                start = pos;
+            }
+        }
+
+        const int end = start + windowLength;
+        int best = 0;
+        double bestEsr = errorToSignalRatio (reference, output, 0, start, end);
+
+        for (int lag = -maxLag; lag <= maxLag; ++lag)
+        {
+            const double esr = errorToSignalRatio (reference, output, lag, start, end);
+
+            if (esr < bestEsr)
+            {
+                bestEsr = esr;
+                best = lag;
+            }
+        }
+
+        return best;
+    }
+
+    //==============================================================================
+    void setParameter (MBDistProcessor& processor, const juce::String& id, float value)
+    {
+        if (auto* param = processor.apvts.getParameter (id))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+
+    struct Result
+    {
+        juce::var toJSON() const
+        {
+            auto* object = new juce::DynamicObject();
+            object->setProperty ("file", name);
+            object->setProperty ("quality", getQualityNames()[quality]);
+            object->setProperty ("oversampling", 1 << oversampling);
+            object->setProperty ("tier", MBDistProcessor::modelTiers[tier].toLowerCase());
+            object->setProperty ("seconds", seconds);
+            object->setProperty ("lag_samples", lag);
+            object->setProperty ("esr", esr);
+            object->setProperty ("esr_db", 10.0 * std::log10 (juce::jmax (esr, 1.0e-12)));
+            object->setProperty ("lsd_db", spectralDistance);
+            object->setProperty ("realtime_factor", realtimeFactor);
+            object->setProperty ("lossy_reference", lossy);
+            object->setProperty ("max_esr", limits.maxEsr);
+            object->setProperty ("max_lsd_db", limits.maxSpectralDistance);
+            object->setProperty ("min_realtime_factor", limits.minRealtimeFactor);
+            object->setProperty ("passed", passed);
+            return juce::var (object);
+        }
+
+        juce::String name;
+        int quality = 0, oversampling = 0, tier = 0, lag = 0;
+        double seconds = 0.0, esr = 0.0, spectralDistance = 0.0, realtimeFactor = 0.0;
+        Thresholds limits {};
+        bool lossy = false, passed = false;
+    };
+
+    /** Renders source through the processor as a host would, in real-time blocks, and returns
+        the output aligned with the input (the reported latency removed).
+    */
+    juce::AudioBuffer<float> render (MBDistProcessor& processor, const juce::AudioBuffer<float>& source,
+                                     int blockSize, double& processingSeconds)
+    {
+        const int numChannels = source.getNumChannels();
+        const int length = source.getNumSamples();
+        const int latency = processor.getLatencySamples();
+
+        juce::AudioBuffer<float> result (numChannels, length);
+        juce::AudioBuffer<float> block (numChannels, blockSize);
+        juce::MidiBuffer midi;
+        processingSeconds = 0.0;
+
+        for (int pos = 0; pos < length + latency; pos += blockSize)
+        {
+            const int numSamples = juce::jmin (blockSize, length + latency - pos);
+            block.setSize (numChannels, numSamples, false, false, true);
+            block.clear();
+
+            for (int ch = 0; ch < numChannels && pos < length; ++ch)
+                block.copyFrom (ch, 0, source, ch, pos, juce::jmin (numSamples, length - pos));
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (block, midi);
+            processingSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            const int outFrom = juce::jmax (pos - latency, 0);
+            const int outTo = juce::jmin (pos + numSamples - latency, length);
+
+            for (int ch = 0; ch < numChannels && outFrom < outTo; ++ch)
+                result.copyFrom (ch, outFrom, block, ch, outFrom - (pos - latency), outTo - outFrom);
+        }
+
+        return result;
+    }
+
+    Result runCase (MBDistProcessor& processor, const Options& options, const CorpusItem& item,
+                    const juce::AudioBuffer<float>& dry, const juce::AudioBuffer<float>& wet, double sampleRate,
+                    int quality, int oversampling, int tier)
+    {
+        setParameter (processor, "Quality", (float) quality);
+        setParameter (processor, "Oversampling", (float) oversampling);
+        setParameter (processor, "Tier", (float) tier);
+
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            const auto& settings = item.bands[(size_t) band];
+            const auto prefix = "Band" + juce::String (band + 1);
+
+            setParameter (processor, prefix, (float) settings.effect);
+            setParameter (processor, prefix + "Gain", settings.gain);
+            setParameter (processor, prefix + "Tone", settings.tone);
+        }
+
+        // Every case starts from a freshly prepared processor, like the reference from silence
+        processor.setRateAndBufferSizeDetails (sampleRate, options.blockSize);
+        processor.prepareToPlay (sampleRate, options.blockSize);
+
+        double processingSeconds = 0.0;
+        const auto output = render (processor, dry, options.blockSize, processingSeconds);
+        processor.releaseResources();
+
+        Result result;
+        result.name = item.name;
+        result.quality = quality;
+        result.oversampling = oversampling;
+        result.tier = tier;
+        result.seconds = dry.getNumSamples() / sampleRate;
+        result.lossy = ! isLossless (item.wet);
+        result.limits = options.thresholds[(size_t) quality];
+
+        if (result.lossy)
+        {
+            result.limits.maxEsr += options.lossyMargin.maxEsr;
+            result.limits.maxSpectralDistance += options.lossyMargin.maxSpectralDistance;
+        }
+
+        const int maxLag = options.maxLag >= 0 ? options.maxLag : (result.lossy ? lossyMaxLag : 0);
+        const double maxFrequency = result.lossy ? lossyMaxFrequency : sampleRate / 2;
+
+        result.lag = maxLag > 0 ? findBestLag (wet, output, maxLag, (int) sampleRate) : 0;
+        result.esr = errorToSignalRatio (wet, output, result.lag);
+        result.spectralDistance = logSpectralDistance (wet, output, result.lag, sampleRate, maxFrequency);
+        result.realtimeFactor = result.seconds / juce::jmax (processingSeconds, 1.0e-9);
+        result.passed = result.esr <= result.limits.maxEsr
+                         && result.spectralDistance <= result.limits.maxSpectralDistance
+                         && result.realtimeFactor >= result.limits.minRealtimeFactor;
+        return result;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    if (args.contains ("-h") || args.contains ("--help"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+    juce::String error;
+
+    if (! parseOptions (args, options, error))
+    {
+        std::cerr << error << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    const auto corpus = findCorpus (options.corpus, formats);
+
+    if (corpus.isEmpty())
+    {
+        std::cerr << "No reference renders in " << options.corpus.getChildFile ("wet").getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (options.modelFile == juce::File())
+        options.modelFile = PrismModel::getDefaultModelFile();
+
+    if (! options.modelFile.existsAsFile())
+    {
+        std::cerr << "No model at " << options.modelFile.getFullPathName() << ", skipping" << std::endl;
+        return skippedExitCode;
+    }
+
+    MBDistProcessor processor;
+    processor.setNonRealtime (false);
+
+    if (! processor.loadModel (options.modelFile, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    // Without a live model the Tier choice has no effect: the live cases would repeat the full ones
+    if (! processor.hasLiveModel() && options.tiers.contains ((int) MBDistProcessor::ModelTier::live))
+    {
+        std::cerr << "No live model installed: skipping the live tier" << std::endl;
+        options.tiers.removeFirstMatchingValue ((int) MBDistProcessor::ModelTier::live);
+    }
+
+    if (options.tiers.isEmpty())
+    {
+        std::cerr << "Nothing to measure" << std::endl;
+        return 1;
+    }
+
+    juce::Array<juce::var> results;
+    int numFailed = 0;
+
+    for (auto& item : corpus)
+    {
+        juce::AudioBuffer<float> dry, wet;
+        double drySampleRate = 0.0, wetSampleRate = 0.0;
+        const int maxLength = options.seconds > 0.0 ? (int) (options.seconds * 192000.0) : std::numeric_limits<int>::max();
+
+        if (! readFile (formats, item.dry, dry, drySampleRate, maxLength) || ! readFile (formats, item.wet, wet, wetSampleRate, maxLength))
+        {
+            std::cerr << "Could not read " << item.name << std::endl;
+            return 1;
+        }
+
+        if (drySampleRate != wetSampleRate)
+        {
+            std::cerr << "Sample rates differ for " << item.name << std::endl;
+            return 1;
+        }
+
+        // Compare what both files cover, on the channels both have
+        const int numChannels = juce::jmin (dry.getNumChannels(), wet.getNumChannels(), MBDistProcessor::maxNumChannels);
+        int length = juce::jmin (dry.getNumSamples(), wet.getNumSamples());
+
+        if (options.seconds > 0.0)
+            length = juce::jmin (length, (int) (options.seconds * drySampleRate));
+
+        dry.setSize (numChannels, length, true);
+        wet.setSize (numChannels, length, true);
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+        layout.outputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+
+        if (! processor.setBusesLayout (layout))
+        {
+            std::cerr << "Unsupported channel count: " << numChannels << std::endl;
+            return 1;
+        }
+
+        for (auto tier : options.tiers)
+            for (auto oversampling : options.oversampling)
+                for (auto quality : options.qualities)
+                {
+                    const auto result = runCase (processor, options, item, dry, wet, drySampleRate, quality, oversampling, tier);
+                    results.add (result.toJSON());
+
+                    if (! result.passed)
+                        ++numFailed;
+
+                    std::cerr << (result.passed ? "[ok]   " : "[FAIL] ") << item.name << ", "
+                              << MBDistProcessor::modelTiers[tier] << ", " << (1 << oversampling) << "x, "
+                              << getQualityNames()[quality]
+                              << ": ESR " << juce::String (result.esr, 4)
+                              << ", LSD " << juce::String (result.spectralDistance, 2) << " dB, "
+                              << juce::String (result.realtimeFactor, 1) << "x real time" << std::endl;
+                }
+    }
+
+    auto* thresholds = new juce::DynamicObject();
+
+    for (int quality = 0; quality < getQualityNames().size(); ++quality)
+    {
+        auto* limits = new juce::DynamicObject();
+        limits->setProperty ("max_esr", options.thresholds[(size_t) quality].maxEsr);
+        limits->setProperty ("max_lsd_db", options.thresholds[(size_t) quality].maxSpectralDistance);
+        limits->setProperty ("min_realtime_factor", options.thresholds[(size_t) quality].minRealtimeFactor);
+        thresholds->setProperty (getQualityNames()[quality], juce::var (limits));
+    }
+
+    auto* lossyMargin = new juce::DynamicObject();
+    lossyMargin->setProperty ("esr", options.lossyMargin.maxEsr);
+    lossyMargin->setProperty ("lsd_db", options.lossyMargin.maxSpectralDistance);
+    thresholds->setProperty ("lossy_margin", juce::var (lossyMargin));
+
+    auto* system = new juce::DynamicObject();
+    system->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    system->setProperty ("kernels", TCNKernels::get().name);
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("benchmark", "accuracy");
+    report->setProperty ("model", options.modelFile.getFullPathName());
+    report->setProperty ("live_model", processor.hasLiveModel());
+    report->setProperty ("corpus", options.corpus.getFullPathName());
+    report->setProperty ("system", juce::var (system));
+    report->setProperty ("thresholds", juce::var (thresholds));
+    report->setProperty ("failed", numFailed);
+    report->setProperty ("results", results);
+
+    const auto json = juce::JSON::toString (juce::var (report));
+
+    if (options.outputFile != juce::File())
+    {
+        if (! options.outputFile.replaceWithText (json))
+        {
+            std::cerr << "Could not write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    std::cerr << results.size() - numFailed << " of " << results.size() << " cases within the thresholds" << std::endl;
+    return numFailed > 0 ? 2 : 0;
+}
@@ -0,0 +1,509 @@
+/*
+  ==============================================================================
+
+    Benchmark.cpp
+    processBlock micro-benchmarks with JSON output.
+
+    Drives MBDistProcessor with synthetic audio across buffer sizes, sample
+    rates, band-effect mixes, oversampling factors and quality modes, and reports
+    the cost per sample, the real-time factor and the block time distribution of
+    each case.
+
+    With --instances, each case also runs several processors side by side, the way
+    a host runs several tracks: every block goes through all of them in turn, and
+    the block time is the whole host cycle. PrismBenchmarkBatched uses this to show
+    how batched inference scales with the number of instances.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+namespace
+{
+    struct Options
+    {
+        juce::Array<int> bufferSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+        juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+        juce::Array<int> oversampling { 0, 1, 2, 3 };   // indices into MBDistProcessor::oversamplingFactors
+        juce::Array<int> qualities { 0 };                // indices into MBDistProcessor::qualityModes
+        juce::Array<int> instances { 1 };                // processors per host cycle
+        juce::StringArray mixes { "default", "distortion", "fuzz", "overdrive", "alternating" };
+        juce::File modelFile;                            // empty: default model, else a synthetic one
+        juce::File outputFile;                           // empty: stdout
+        int numChannels = 2;
+        double seconds = 2.0;                            // measured audio per case
+        double warmupSeconds = 0.25;
+    };
+
+    void printUsage()
+    {
+        std::cerr
+            << "Usage: PrismBenchmark [options]\n"
+               "\n"
+               "  --buffers <n,n,...>       Buffer sizes (default: 16,32,...,4096)\n"
+               "  --rates <hz,hz,...>       Sample rates (default: 44100,48000,96000)\n"
+               "  --oversampling <1,2,...>  Oversampling factors (default: 1,2,4,8)\n"
+               "  --mixes <name,...>        Band-effect mixes: default, distortion, fuzz, overdrive, alternating\n"
+               "  --quality <name,...>      Network precision: fp32, fp16, int8 (default: fp32)\n"
+               "  --instances <n,n,...>     Processors run per host cycle (default: 1)\n"
+               "  --channels <n>            Channels (default: 2)\n"
+               "  --seconds <s>             Audio measured per case (default: 2)\n"
+               "  -m, --model <file>        Model file (default: installed model, else a synthetic one)\n"
+               "  -o, --output <file>       Write the JSON report to a file instead of stdout\n";
+    }
+
+    juce::StringArray splitList (const juce::String& text)
+    {
+        return juce::StringArray::fromTokens (text, ",", "");
+    }
+
+    // Command-line names of MBDistProcessor::qualityModes, in the same order
+    const juce::StringArray& getQualityNames()
+    {
+        static const juce::StringArray names { "fp32", "fp16", "int8" };
+        return names;
+    }
+
+    bool parseOptions (const juce::StringArray& args, Options& options, juce::String& error)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            auto next = [&] { return i + 1 < args.size() ? args[++i] : juce::String(); };
+
+            if (arg == "--buffers")
+            {
+                options.bufferSizes.clear();
+                for (auto& token : splitList (next()))
+                    options.bufferSizes.add (juce::jlimit (1, 65536, token.getIntValue()));
+            }
+            else if (arg == "--rates")
+            {
+                options.sampleRates.clear();
+                for (auto& token : splitList (next()))
+                    options.sampleRates.add (juce::jlimit (8000.0, 768000.0, token.getDoubleValue()));
+            }
+            else if (arg == "--oversampling")
+            {
+                options.oversampling.clear();
+                for (auto& token : splitList (next()))
+                {
+                    const int index = MBDistProcessor::oversamplingFactors.indexOf (token.trim() + "x");
+
+                    if (index < 0)
+                    {
+                        error = "Oversampling must be 1, 2, 4 or 8";
+                        return false;
+                    }
+
+                    options.oversampling.add (index);
+                }
+            }
+            else if (arg == "--quality")
+            {
+                options.qualities.clear();
+                for (auto& token : splitList (next()))
+                {
+                    const int index = getQualityNames().indexOf (token.trim(), true);
+
+                    if (index < 0)
+                    {
+                        error = "Quality must be fp32, fp16 or int8";
+                        return false;
+                    }
+
+                    options.qualities.add (index);
+                }
+            }
+            else if (arg == "--instances")
+            {
+                options.instances.clear();
+                for (auto& token : splitList (next()))
+                    options.instances.add (juce::jlimit (1, 64, token.getIntValue()));
+            }
+            else if (arg == "--mixes")                     options.mixes = splitList (next());
+            else if (arg == "--channels")                  options.numChannels = juce::jlimit (1, 16, next().getIntValue());
+            else if (arg == "--seconds")                   options.seconds = juce::jmax (0.01, next().getDoubleValue());
+            else if (arg == "-m" || arg == "--model")      options.modelFile = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else if (arg == "-o" || arg == "--output")     options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else
+            {
+                error = "Unknown option: " + arg;
+                return false;
+            }
+        }
+
+        if (options.bufferSizes.isEmpty() || options.sampleRates.isEmpty() || options.oversampling.isEmpty() || options.mixes.isEmpty()
+             || options.qualities.isEmpty() || options.instances.isEmpty())
+        {
+            error = "Nothing to measure";
+            return false;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    /** Writes a model of a typical size (16 channels, 10 layers) with small random weights,
+        so the benchmark also runs on machines without a trained model installed.
+    */
+    bool writeSyntheticModel (const juce::File& file)
+    {
+        constexpr int channels = 16, kernelSize = 3;
+        const int dilations[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 };
+
+        juce::Random random (0x5052534d);
+        auto tensor = [&] (int size)
+        {
+            juce::Array<juce::var> values;
+            for (int i = 0; i < size; ++i)
+                values.add ((random.nextFloat() - 0.5f) * 0.2f);
+            return juce::var (values);
+        };
+
+        auto linear = [&] (int weights, int biases)
+        {
+            auto* object = new juce::DynamicObject();
+            object->setProperty ("weight", tensor (weights));
+            object->setProperty ("bias", tensor (biases));
+            return juce::var (object);
+        };
+
+        juce::Array<juce::var> layers;
+
+        for (auto dilation : dilations)
+        {
+            auto* layer = new juce::DynamicObject();
+            layer->setProperty ("dilation", dilation);
+            layer->setProperty ("conv", linear (channels * channels * kernelSize, channels));
+            layer->setProperty ("film", linear (2 * channels * PrismModel::conditioningSize, 2 * channels));
+            layer->setProperty ("mix", linear (channels * channels, channels));
+            layers.add (juce::var (layer));
+        }
+
+        auto* output = new juce::DynamicObject();
+        output->setProperty ("weight", tensor (channels));
+        output->setProperty ("bias", 0.0);
+
+        auto* model = new juce::DynamicObject();
+        model->setProperty ("channels", channels);
+        model->setProperty ("kernel_size", kernelSize);
+        model->setProperty ("sample_rate", 48000.0);
+        model->setProperty ("input", linear (channels, channels));
+        model->setProperty ("layers", layers);
+        model->setProperty ("output", juce::var (output));
+
+        return file.replaceWithText (juce::JSON::toString (juce::var (model), true));
+    }
+
+    void setParameter (MBDistProcessor& processor, const juce::String& id, float value)
+    {
+        if (auto* param = processor.apvts.getParameter (id))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+
+    void applyMix (MBDistProcessor& processor, const juce::String& mix)
+    {
+        for (int band = 0; band < NUM_BANDS; ++band)
+        {
+            int effect = MBDistProcessor::bandEffects.indexOf (mix, true);
+
+            if (mix == "default")           effect = band / 3;    // the parameter defaults
+            else if (mix == "alternating")  effect = band % MBDistProcessor::bandEffects.size();
+
+            setParameter (processor, "Band" + juce::String (band + 1), (float) juce::jmax (0, effect));
+        }
+    }
+
+    //==============================================================================
+    struct Result
+    {
+        juce::var toJSON() const
+        {
+            auto* object = new juce::DynamicObject();
+            object->setProperty ("buffer_size", bufferSize);
+            object->setProperty ("sample_rate", sampleRate);
+            object->setProperty ("oversampling", 1 << oversampling);
+            object->setProperty ("mix", mix);
+            object->setProperty ("quality", getQualityNames()[quality]);
+            object->setProperty ("channels", numChannels);
+            object->setProperty ("instances", numInstances);
+            object->setProperty ("latency_samples", latency);
+            object->setProperty ("blocks", numBlocks);
+            object->setProperty ("ns_per_sample", nsPerSample);
+            object->setProperty ("realtime_factor", realtimeFactor);
+            object->setProperty ("throughput", throughput());
+            object->setProperty ("block_deadline_us", deadlineUs);
+            object->setProperty ("block_mean_us", meanUs);
+            object->setProperty ("block_p50_us", p50Us);
+            object->setProperty ("block_p99_us", p99Us);
+            object->setProperty ("block_p999_us", p999Us);
+            object->setProperty ("block_max_us", maxUs);
+            return juce::var (object);
+        }
+
+        // Seconds of audio per second across all instances
+        double throughput() const noexcept      { return numInstances * realtimeFactor; }
+
+        int bufferSize = 0, oversampling = 0, quality = 0, numChannels = 0, numInstances = 1, latency = 0, numBlocks = 0;
+        double sampleRate = 0.0;
+        juce::String mix;
+        double nsPerSample = 0.0, realtimeFactor = 0.0, deadlineUs = 0.0;
+        double meanUs = 0.0, p50Us = 0.0, p99Us = 0.0, p999Us = 0.0, maxUs = 0.0;
+    };
+
+    double percentile (const std::vector<double>& sorted, double fraction)
+    {
+        const auto index = (size_t) std::ceil (fraction * (double) sorted.size());
+        return sorted[juce::jlimit ((size_t) 0, sorted.size() - 1, index == 0 ? 0 : index - 1)];
+    }
+
+    Result runCase (const juce::Array<MBDistProcessor*>& processors, const Options& options, int bufferSize,
+                    double sampleRate, int oversampling, int quality, const juce::String& mix)
+    {
+        for (auto* processor : processors)
+        {
+            setParameter (*processor, "Oversampling", (float) oversampling);
+            setParameter (*processor, "Quality", (float) quality);
+            applyMix (*processor, mix);
+
+            processor->setRateAndBufferSizeDetails (sampleRate, bufferSize);
+            processor->prepareToPlay (sampleRate, bufferSize);
+        }
+
+        // Synthetic input: a slow sweep over noise, the same for every case and instance
+        juce::AudioBuffer<float> buffer (options.numChannels, bufferSize);
+        juce::OwnedArray<juce::AudioBuffer<float>> instanceBuffers;
+
+        for (int i = 0; i < processors.size(); ++i)
+            instanceBuffers.add (new juce::AudioBuffer<float> (options.numChannels, bufferSize));
+
+        juce::MidiBuffer midi;
+        juce::Random random (1);
+        double phase = 0.0;
+
+        auto fill = [&] (int blockIndex)
+        {
+            for (int i = 0; i < bufferSize; ++i)
+            {
+                const double t = (double) (blockIndex * bufferSize + i) / sampleRate;
+                phase += juce::MathConstants<double>::twoPi * (50.0 + 2000.0 * std::fmod (t, 1.0)) / sampleRate;
+                const float sweep = 0.4f * (float) std::sin (phase);
+
+                for (int ch = 0; ch < options.numChannels; ++ch)
+                    buffer.setSample (ch, i, sweep + 0.1f * (random.nextFloat() - 0.5f));
+            }
+        };
+
+        const int warmupBlocks = juce::jmax (1, (int) (options.warmupSeconds * sampleRate) / bufferSize);
+        const int numBlocks = juce::jmax (16, (int) (options.seconds * sampleRate) / bufferSize);
+
+        // One host cycle: every instance processes its own copy of the block
+        auto process = [&]
+        {
+            for (int i = 0; i < processors.size(); ++i)
+                processors.getUnchecked (i)->processBlock (*instanceBuffers.getUnchecked (i), midi);
+        };
+
+        auto copyInput = [&]
+        {
+            for (auto* instanceBuffer : instanceBuffers)
+                instanceBuffer->makeCopyOf (buffer, true);
+        };
+
+        for (int b = 0; b < warmupBlocks; ++b)
+        {
+            fill (b);
+            copyInput();
+            process();
+        }
+
+        std::vector<double> blockTimes;
+        blockTimes.reserve ((size_t) numBlocks);
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            fill (warmupBlocks + b);
+            copyInput();
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            process();
+            const auto end = juce::Time::getHighResolutionTicks();
+
+            blockTimes.push_back (juce::Time::highResolutionTicksToSeconds (end - start));
+        }
+
+        for (auto* processor : processors)
+            processor->releaseResources();
+
+        const double total = std::accumulate (blockTimes.begin(), blockTimes.end(), 0.0);
+        std::sort (blockTimes.begin(), blockTimes.end());
+
+        Result result;
+        result.bufferSize = bufferSize;
+        result.sampleRate = sampleRate;
+        result.oversampling = oversampling;
+        result.quality = quality;
+        result.mix = mix;
+        result.numChannels = options.numChannels;
+        result.numInstances = processors.size();
+        result.latency = processors.getFirst()->getLatencySamples();
+        result.numBlocks = numBlocks;
+        result.nsPerSample = total * 1.0e9 / ((double) numBlocks * bufferSize);
+        result.realtimeFactor = ((double) numBlocks * bufferSize / sampleRate) / total;
+        result.deadlineUs = bufferSize / sampleRate * 1.0e6;
+        result.meanUs = total / numBlocks * 1.0e6;
+        result.p50Us = percentile (blockTimes, 0.5) * 1.0e6;
+        result.p99Us = percentile (blockTimes, 0.99) * 1.0e6;
+        result.p999Us = percentile (blockTimes, 0.999) * 1.0e6;
+        result.maxUs = blockTimes.back() * 1.0e6;
+        return result;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    if (args.contains ("-h") || args.contains ("--help"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+    juce::String error;
+
+    if (! parseOptions (args, options, error))
+    {
+        std::cerr << error << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    for (auto& mix : options.mixes)
+    {
+        if (mix != "default" && mix != "alternating" && ! MBDistProcessor::bandEffects.contains (mix, true))
+        {
+            std::cerr << "Unknown mix: " << mix << std::endl;
+            return 1;
+        }
+    }
+
+    // Model: explicit file, else the installed one, else synthetic weights of the same shape
+    juce::TemporaryFile syntheticModel (".json");
+    bool synthetic = false;
+
+    if (options.modelFile == juce::File())
+    {
+        options.modelFile = PrismModel::getDefaultModelFile();
+
+        if (! options.modelFile.existsAsFile())
+        {
+            if (! writeSyntheticModel (syntheticModel.getFile()))
+            {
+                std::cerr << "Could not write a synthetic model" << std::endl;
+                return 1;
+            }
+
+            options.modelFile = syntheticModel.getFile();
+            synthetic = true;
+        }
+    }
+
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (juce::AudioChannelSet::canonicalChannelSet (options.numChannels));
+    layout.outputBuses.add (juce::AudioChannelSet::canonicalChannelSet (options.numChannels));
+
+    juce::OwnedArray<MBDistProcessor> processors;
+    int maxInstances = 1;
+
+    for (auto n : options.instances)
+        maxInstances = juce::jmax (maxInstances, n);
+
+    for (int i = 0; i < maxInstances; ++i)
+    {
+        auto* processor = processors.add (new MBDistProcessor());
+        processor->setNonRealtime (false);
+
+        if (! processor->loadModel (options.modelFile, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        if (! processor->setBusesLayout (layout))
+        {
+            std::cerr << "Unsupported channel count: " << options.numChannels << std::endl;
+            return 1;
+        }
+    }
+
+    juce::Array<juce::var> results;
+    const int numCases = options.sampleRates.size() * options.oversampling.size() * options.qualities.size()
+                          * options.mixes.size() * options.bufferSizes.size() * options.instances.size();
+
+    for (auto sampleRate : options.sampleRates)
+        for (auto oversampling : options.oversampling)
+            for (auto quality : options.qualities)
+                for (auto& mix : options.mixes)
+                    for (auto bufferSize : options.bufferSizes)
+                        for (auto numInstances : options.instances)
+                        {
+                            juce::Array<MBDistProcessor*> instances (processors.begin(), numInstances);
+
+                            auto result = runCase (instances, options, bufferSize, sampleRate, oversampling, quality, mix);
+                            results.add (result.toJSON());
+
+                            std::cerr << "[" << results.size() << "/" << numCases << "] "
+                                      << bufferSize << " @ " << sampleRate << " Hz, " << (1 << oversampling) << "x, "
+                                      << getQualityNames()[quality] << ", " << mix << ", " << numInstances << " instance(s)"
+                                      << ": " << juce::String (result.nsPerSample, 1) << " ns/sample, "
+                                      << juce::String (result.realtimeFactor, 1) << "x real time, "
+                                      << juce::String (result.throughput(), 1) << "x throughput" << std::endl;
+                        }
+
+    auto* model = new juce::DynamicObject();
+    model->setProperty ("file", synthetic ? juce::String ("synthetic") : options.modelFile.getFullPathName());
+
+    auto* system = new juce::DynamicObject();
+    system->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    system->setProperty ("cores", juce::SystemStats::getNumPhysicalCpus());
+    system->setProperty ("kernels", TCNKernels::get().name);
+    system->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+   #ifdef BATCHED_INFERENCE
+    system->setProperty ("batched_inference", true);
+   #else
+    system->setProperty ("batched_inference", false);
+   #endif
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("benchmark", "processBlock");
+    report->setProperty ("system", juce::var (system));
+    report->setProperty ("model", juce::var (model));
+    report->setProperty ("results", results);
+
+    const auto json = juce::JSON::toString (juce::var (report));
+
+    if (options.outputFile != juce::File())
+    {
+        if (! options.outputFile.replaceWithText (json))
+        {
+            std::cerr << "Could not write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
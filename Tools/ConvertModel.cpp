@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    ConvertModel.cpp
+    Converts a JSON model export into the memory-mappable binary format.
+
+    Usage: PrismModelConvert <model.json> [model.bin]
+
+    Without an output file, the model is written next to the input with a
+    .bin extension. Installing the result as prism-model.bin in the Prism
+    settings folder makes the plugin map it instead of parsing the JSON.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PrismModel.h"
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: PrismModelConvert <model.json> [model.bin]" << std::endl;
+        return 1;
+    }
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    const auto input = cwd.getChildFile (argv[1]);
+    const auto output = argc > 2 ? cwd.getChildFile (argv[2]) : input.withFileExtension ("bin");
+
+    juce::String error;
+    auto model = PrismModel::loadFromFile (input, error);
+
+    if (model == nullptr)
+    {
+        std::cerr << input.getFullPathName() << ": " << error << std::endl;
+        return 1;
+    }
+
+    // Write aside and rename: a running instance may have the previous file mapped
+    juce::TemporaryFile temp (output);
+
+    {
+        juce::FileOutputStream stream (temp.getFile());
+
+        if (! stream.openedOk() || ! model->writeBinary (stream))
+        {
+            std::cerr << "Could not write " << output.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    if (! temp.overwriteTargetFileWithTemporary())
+    {
+        std::cerr << "Could not replace " << output.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // Check the result loads back
+    if (PrismModel::loadFromBinaryFile (output, error) == nullptr)
+    {
+        std::cerr << output.getFullPathName() << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << output.getFullPathName() << " (" << model->getNumLayers() << " layers, "
+              << model->getNumChannels() << " channels, " << output.getSize() << " bytes)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,442 @@
+/*
+  ==============================================================================
+
+    RenderCli.cpp
+    Headless offline renderer: runs MBDistProcessor over audio files.
+
+    Files are rendered concurrently on a thread pool. Long files are also cut
+    into independent chunks; every chunk is rendered from a pre-roll covering
+    the network's receptive field and the crossover settling time, so chunk
+    joins are inaudible.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+namespace
+{
+    struct BandSetting
+    {
+        int effect = -1;            // -1 keeps the processor default
+        float gain = -1.0f;
+        float tone = -1.0f;
+    };
+
+    struct Options
+    {
+        juce::Array<juce::File> inputs;
+        juce::File outputDirectory = juce::File::getCurrentWorkingDirectory();
+        juce::File modelFile = PrismModel::getDefaultModelFile();
+        juce::String format;        // empty: same as the input
+        juce::String suffix = "_prism";
+        int numThreads = juce::SystemStats::getNumCpus();
+        int blockSize = 4096;
+        double chunkSeconds = 30.0;
+        int oversampling = 0;       // index into MBDistProcessor::oversamplingFactors
+        std::array<BandSetting, NUM_BANDS> bands;
+    };
+
+    void printUsage()
+    {
+        std::cout
+            << "Usage: PrismRender [options] <input files...>\n"
+               "\n"
+               "  -o, --output <dir>        Output folder (default: current folder)\n"
+               "  -m, --model <file>        Model file (default: " << PrismModel::getDefaultModelFile().getFullPathName() << ")\n"
+               "  -f, --format <wav|flac>   Output format (default: same as input)\n"
+               "  -s, --suffix <text>       Appended to output file names (default: _prism)\n"
+               "  -j, --threads <n>         Worker threads (default: number of CPUs)\n"
+               "  -b, --block <n>           Processing block size (default: 4096)\n"
+               "  -c, --chunk <seconds>     Split files into chunks of this length, 0 to disable (default: 30)\n"
+               "  -x, --oversampling <1|2|4|8>\n"
+               "  --band <n>=<effect>,<gain>,<tone>\n"
+               "                            Band n (1-" << NUM_BANDS << "), effect is Distortion, Fuzz or Overdrive\n"
+               "  --all <effect>,<gain>,<tone>\n"
+               "                            Same settings for every band\n";
+    }
+
+    bool parseBandSetting (const juce::String& text, BandSetting& setting)
+    {
+        auto tokens = juce::StringArray::fromTokens (text, ",", "");
+
+        if (tokens.size() != 3)
+            return false;
+
+        for (int i = 0; i < MBDistProcessor::bandEffects.size(); ++i)
+            if (MBDistProcessor::bandEffects[i].equalsIgnoreCase (tokens[0].trim()))
+                setting.effect = i;
+
+        if (setting.effect < 0 && tokens[0].trim().containsOnly ("0123456789"))
+            setting.effect = tokens[0].getIntValue();
+
+        setting.gain = tokens[1].getFloatValue();
+        setting.tone = tokens[2].getFloatValue();
+
+        return juce::isPositiveAndBelow (setting.effect, MBDistProcessor::bandEffects.size());
+    }
+
+    bool parseOptions (const juce::StringArray& args, Options& options, juce::String& error)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            auto next = [&] { return i + 1 < args.size() ? args[++i] : juce::String(); };
+
+            if (arg == "-o" || arg == "--output")              options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else if (arg == "-m" || arg == "--model")          options.modelFile = juce::File::getCurrentWorkingDirectory().getChildFile (next());
+            else if (arg == "-f" || arg == "--format")         options.format = next().toLowerCase();
+            else if (arg == "-s" || arg == "--suffix")         options.suffix = next();
+            else if (arg == "-j" || arg == "--threads")        options.numThreads = juce::jmax (1, next().getIntValue());
+            else if (arg == "-b" || arg == "--block")          options.blockSize = juce::jlimit (16, 65536, next().getIntValue());
+            else if (arg == "-c" || arg == "--chunk")          options.chunkSeconds = juce::jmax (0.0, next().getDoubleValue());
+            else if (arg == "-x" || arg == "--oversampling")
+            {
+                options.oversampling = MBDistProcessor::oversamplingFactors.indexOf (next() + "x");
+
+                if (options.oversampling < 0)
+                {
+                    error = "Oversampling must be 1, 2, 4 or 8";
+                    return false;
+                }
+            }
+            else if (arg == "--band")
+            {
+                auto value = next();
+                const int band = value.upToFirstOccurrenceOf ("=", false, false).getIntValue() - 1;
+                BandSetting setting;
+
+                if (! juce::isPositiveAndBelow (band, NUM_BANDS)
+                    || ! parseBandSetting (value.fromFirstOccurrenceOf ("=", false, false), setting))
+                {
+                    error = "Invalid band setting: " + value;
+                    return false;
+                }
+
+                options.bands[(size_t) band] = setting;
+            }
+            else if (arg == "--all")
+            {
+                BandSetting setting;
+
+                if (! parseBandSetting (next(), setting))
+                {
+                    error = "Invalid band setting for --all";
+                    return false;
+                }
+
+                options.bands.fill (setting);
+            }
+            else if (arg.startsWith ("-"))
+            {
+                error = "Unknown option: " + arg;
+                return false;
+            }
+            else
+            {
+                options.inputs.add (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+            }
+        }
+
+        if (options.format.isNotEmpty() && options.format != "wav" && options.format != "flac")
+        {
+            error = "Output format must be wav or flac";
+            return false;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    void setParameter (MBDistProcessor& processor, const juce::String& id, float value)
+    {
+        if (auto* param = processor.apvts.getParameter (id))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+
+    /** Processor instances are expensive to create: workers borrow and return them. */
+    class ProcessorPool
+    {
+    public:
+        explicit ProcessorPool (const Options& o) : options (o) {}
+
+        std::unique_ptr<MBDistProcessor> acquire (juce::String& error)
+        {
+            {
+                const juce::ScopedLock sl (lock);
+
+                if (! idle.empty())
+                {
+                    auto processor = std::move (idle.back());
+                    idle.pop_back();
+                    return processor;
+                }
+            }
+
+            auto processor = std::make_unique<MBDistProcessor>();
+
+            if (! processor->loadModel (options.modelFile, error))
+                return nullptr;
+
+            processor->setNonRealtime (true);
+
+            setParameter (*processor, "Oversampling", (float) options.oversampling);
+
+            for (int band = 0; band < NUM_BANDS; ++band)
+            {
+                const auto& setting = options.bands[(size_t) band];
+                const auto prefix = "Band" + juce::String (band + 1);
+
+                if (setting.effect < 0)
+                    continue;
+
+                setParameter (*processor, prefix, (float) setting.effect);
+                setParameter (*processor, prefix + "Gain", setting.gain);
+                setParameter (*processor, prefix + "Tone", setting.tone);
+            }
+
+            return processor;
+        }
+
+        void release (std::unique_ptr<MBDistProcessor> processor)
+        {
+            const juce::ScopedLock sl (lock);
+            idle.push_back (std::move (processor));
+        }
+
+    private:
+        const Options& options;
+        juce::CriticalSection lock;
+        std::vector<std::unique_ptr<MBDistProcessor>> idle;
+    };
+
+    //==============================================================================
+    struct RenderJob
+    {
+        juce::File input, output;
+        juce::AudioBuffer<float> source, result;
+        double sampleRate = 44100.0;
+        int bitsPerSample = 24;
+        std::atomic<int> chunksLeft { 0 };
+        std::atomic<bool> failed { false };
+    };
+
+    bool prepareProcessor (MBDistProcessor& processor, int numChannels, double sampleRate, int blockSize)
+    {
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+        layout.outputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+
+        if (! processor.setBusesLayout (layout))
+            return false;
+
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        return true;
+    }
+
+    /** Renders result[start, end) from a pre-roll before start, compensating the reported latency. */
+    void renderRange (MBDistProcessor& processor, const juce::AudioBuffer<float>& source,
+                      juce::AudioBuffer<float>& result, int start, int end, int preroll, int blockSize)
+    {
+        const int numChannels = source.getNumChannels();
+        const int latency = processor.getLatencySamples();
+        juce::AudioBuffer<float> block (numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        for (int pos = start - preroll; pos < end + latency; pos += blockSize)
+        {
+            const int numSamples = juce::jmin (blockSize, end + latency - pos);
+            block.setSize (numChannels, numSamples, false, false, true);
+            block.clear();
+
+            // Input outside the file is silence
+            const int from = juce::jmax (pos, 0);
+            const int to = juce::jmin (pos + numSamples, source.getNumSamples());
+
+            for (int ch = 0; ch < numChannels && from < to; ++ch)
+                block.copyFrom (ch, from - pos, source, ch, from, to - from);
+
+            processor.processBlock (block, midi);
+
+            // Output sample n corresponds to input sample n - latency
+            const int outFrom = juce::jmax (pos - latency, start);
+            const int outTo = juce::jmin (pos + numSamples - latency, end);
+
+            for (int ch = 0; ch < numChannels && outFrom < outTo; ++ch)
+                result.copyFrom (ch, outFrom, block, ch, outFrom - (pos - latency), outTo - outFrom);
+        }
+    }
+
+    bool writeFile (RenderJob& job, juce::AudioFormatManager& formats)
+    {
+        auto* format = formats.findFormatForFileExtension (job.output.getFileExtension());
+
+        if (format == nullptr)
+            return false;
+
+        // Written next to the target and moved into place once complete, so a failed
+        // render never leaves a truncated file behind
+        juce::TemporaryFile temp (job.output);
+
+        {
+            auto stream = std::make_unique<juce::FileOutputStream> (temp.getFile());
+
+            if (stream->failedToOpen())
+                return false;
+
+            std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), job.sampleRate,
+                                                                                      (unsigned int) job.result.getNumChannels(),
+                                                                                      job.bitsPerSample, {}, 0));
+            if (writer == nullptr)
+                return false;
+
+            stream.release(); // now owned by the writer
+
+            if (! writer->writeFromAudioSampleBuffer (job.result, 0, job.result.getNumSamples()))
+                return false;
+        }
+
+        return temp.overwriteTargetFileWithTemporary();
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    Options options;
+    juce::String error;
+
+    if (args.isEmpty() || args.contains ("-h") || args.contains ("--help"))
+    {
+        printUsage();
+        return args.isEmpty() ? 1 : 0;
+    }
+
+    if (! parseOptions (args, options, error) || options.inputs.isEmpty())
+    {
+        std::cerr << (error.isNotEmpty() ? error : juce::String ("No input files")) << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    options.outputDirectory.createDirectory();
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    ProcessorPool processors (options);
+    juce::ThreadPool pool (options.numThreads);
+
+    std::atomic<int> jobsInFlight { 0 }, numFailed { 0 };
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    auto finish = [&] (RenderJob& job, bool ok)
+    {
+        if (ok)
+        {
+            std::cout << "Rendered " << job.output.getFullPathName() << std::endl;
+        }
+        else
+        {
+            std::cerr << "Failed: " << job.input.getFullPathName() << std::endl;
+            ++numFailed;
+        }
+
+        --jobsInFlight;
+    };
+
+    for (auto& input : options.inputs)
+    {
+        // Bound memory: only a few files are loaded ahead of the workers
+        while (jobsInFlight.load() >= 2 * options.numThreads)
+            juce::Thread::sleep (5);
+
+        auto job = std::make_shared<RenderJob>();
+        job->input = input;
+        job->output = options.outputDirectory.getChildFile (input.getFileNameWithoutExtension() + options.suffix
+                        + "." + (options.format.isNotEmpty() ? options.format : input.getFileExtension().substring (1).toLowerCase()));
+
+        // Never render over a source file, e.g. with -s "" inside the stem folder
+        if (job->output == job->input || options.inputs.contains (job->output))
+        {
+            std::cerr << "Refusing to overwrite input " << job->output.getFullPathName()
+                      << ": choose another output folder (-o) or suffix (-s)" << std::endl;
+            ++numFailed;
+            continue;
+        }
+
+        ++jobsInFlight;
+
+        pool.addJob ([&, job]
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (job->input));
+
+            if (reader == nullptr || reader->lengthInSamples <= 0)
+                return finish (*job, false);
+
+            job->sampleRate = reader->sampleRate;
+            job->bitsPerSample = job->output.hasFileExtension ("flac") ? juce::jmin (24, (int) reader->bitsPerSample)
+                                                                       : (int) reader->bitsPerSample;
+            job->source.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+            reader->read (&job->source, 0, (int) reader->lengthInSamples, 0, true, true);
+            job->result.setSize (job->source.getNumChannels(), job->source.getNumSamples());
+
+            const int length = job->source.getNumSamples();
+            const int chunkLength = options.chunkSeconds > 0.0 ? juce::jmax (options.blockSize, (int) (options.chunkSeconds * job->sampleRate))
+                                                               : length;
+            const int numChunks = (length + chunkLength - 1) / chunkLength;
+            job->chunksLeft = numChunks;
+
+            for (int chunk = 0; chunk < numChunks; ++chunk)
+            {
+                const int start = chunk * chunkLength;
+                const int end = juce::jmin (length, start + chunkLength);
+
+                pool.addJob ([&, job, start, end]
+                {
+                    juce::String processorError;
+                    auto processor = processors.acquire (processorError);
+
+                    if (processor == nullptr
+                        || ! prepareProcessor (*processor, job->source.getNumChannels(), job->sampleRate, options.blockSize))
+                    {
+                        if (processorError.isNotEmpty())
+                            std::cerr << processorError << std::endl;
+
+                        job->failed = true;
+                    }
+                    else
+                    {
+                        // Pre-roll over the receptive field plus 100 ms for the crossover to settle
+                        const int preroll = start == 0 ? 0 : (int) ((processor->getTailLengthSeconds() + 0.1) * job->sampleRate);
+                        renderRange (*processor, job->source, job->result, start, end, preroll, options.blockSize);
+                        processor->releaseResources();
+                    }
+
+                    if (processor != nullptr)
+                        processors.release (std::move (processor));
+
+                    // The last chunk to finish writes the file
+                    if (--job->chunksLeft == 0)
+                        finish (*job, ! job->failed && writeFile (*job, formats));
+                });
+            }
+        });
+    }
+
+    while (jobsInFlight.load() > 0)
+        juce::Thread::sleep (10);
+
+    std::cout << "Done in " << juce::String ((juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0, 2) << " s, "
+              << numFailed.load() << " failed" << std::endl;
+
+    return numFailed.load() > 0 ? 1 : 0;
+}
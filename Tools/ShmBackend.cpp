@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    ShmBackend.cpp
+    Minimal stand-in for the inference backend on the shared-memory transport.
+
+    Attaches to the region created by a running Prism instance and answers
+    every frame with a simple gain-driven waveshaper, so the transport can be
+    exercised and timed without the Python backend.
+
+    Usage: PrismShmBackend [region-name]
+
+    Every instance has its own region (prism-transport-<pid>-<n>). Without a
+    name the backend attaches to the only region there is, or lists them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <csignal>
+#include "../Source/ShmTransport.h"
+
+namespace
+{
+    std::atomic<bool> shouldExit { false };
+
+    void handleSignal (int)
+    {
+        shouldExit = true;
+    }
+
+    /** Answers a request. The request lives in memory the other process writes, so its counts
+        are read once and checked against the slot sizes; false rejects the frame.
+    */
+    bool processFrame (const ShmTransport::Frame& in, ShmTransport::Frame& out)
+    {
+        const auto numChannels = in.numChannels;
+        const auto numSamples = in.numSamples;
+        const auto numParameters = in.numParameters;
+
+        if (numChannels > (juce::uint32) ShmTransport::maxChannels || numSamples > (juce::uint32) ShmTransport::maxSamples
+             || numParameters > (juce::uint32) ShmTransport::maxParameters)
+            return false;
+
+        // parameters: bypass, then (effect, gain, tone) per band
+        float meanGain = 0.0f;
+        const int numBands = ((int) numParameters - 1) / 3;
+
+        for (int band = 0; band < numBands; ++band)
+            meanGain += in.parameters[1 + 3 * band + 1];
+
+        const float drive = 1.0f + (numBands > 0 ? meanGain / (float) numBands : 0.0f);
+        const bool bypass = numParameters > 0 && in.parameters[0] >= 0.5f;
+
+        out.sequence = in.sequence;
+        out.numChannels = numChannels;
+        out.numSamples = numSamples;
+        out.numParameters = 0;
+
+        for (juce::uint32 ch = 0; ch < numChannels; ++ch)
+            for (juce::uint32 n = 0; n < numSamples; ++n)
+                out.audio[ch][n] = bypass ? in.audio[ch][n] : std::tanh (drive * in.audio[ch][n]);
+
+        return true;
+    }
+
+    juce::StringArray findRegions()
+    {
+        juce::StringArray names;
+
+        for (auto& file : ShmTransport::getRegionFile ("x").getParentDirectory()
+                                       .findChildFiles (juce::File::findFiles, false, "prism-transport-*"))
+            names.add (file.getFileName());
+
+        names.sort (true);
+        return names;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::String name = argc > 1 ? juce::String (argv[1]) : juce::String();
+
+    if (name.isEmpty())
+    {
+        const auto regions = findRegions();
+
+        if (regions.size() != 1)
+        {
+            std::cerr << (regions.isEmpty() ? "No Prism instance is running" : "Several Prism instances are running, pick one:") << std::endl;
+
+            for (auto& region : regions)
+                std::cerr << "  " << region << std::endl;
+
+            return 1;
+        }
+
+        name = regions[0];
+    }
+
+    ShmTransport transport (name, ShmTransport::Role::backend);
+
+    if (! transport.isOpen())
+    {
+        std::cerr << "Could not attach to " << ShmTransport::getRegionFile (name).getFullPathName()
+                  << " (missing, from another version, or served by a live backend)" << std::endl;
+        return 1;
+    }
+
+    std::signal (SIGINT, handleSignal);
+    std::signal (SIGTERM, handleSignal);
+
+    std::cout << "Attached to " << ShmTransport::getRegionFile (name).getFullPathName() << std::endl;
+
+    auto& incoming = transport.getIncoming();
+    auto& outgoing = transport.getOutgoing();
+    juce::uint64 framesServed = 0, framesRejected = 0;
+    int idleSpins = 0;
+
+    while (! shouldExit)
+    {
+        transport.beat();
+
+        auto* request = incoming.beginRead();
+
+        // With the reply ring full the request stays queued: the plugin drains stale replies on
+        // its next block, and counts the frames it gave up on itself
+        auto* reply = request != nullptr ? outgoing.beginWrite() : nullptr;
+
+        if (reply == nullptr)
+        {
+            // Spin for a while to keep round trips short, then back off
+            if (++idleSpins < 4096)
+                ShmTransport::cpuRelax();
+            else
+                juce::Thread::yield();
+
+            continue;
+        }
+
+        idleSpins = 0;
+
+        if (processFrame (*request, *reply))
+        {
+            outgoing.finishWrite();
+            ++framesServed;
+        }
+        else
+        {
+            ++framesRejected;
+        }
+
+        incoming.finishRead();
+    }
+
+    std::cout << "Served " << framesServed << " frames";
+
+    if (framesRejected > 0)
+        std::cout << ", rejected " << framesRejected << " malformed ones";
+
+    std::cout << std::endl;
+    return 0;
+}